@@ -20,10 +20,17 @@ extern unsigned char charset[];
 // Bottom line, program+vars needs to stay below $9A1F
 
 #define CHARSET_LOC 0xB000
-#define SCREEN_LOC ((uint8_t *)0xB400)
+#define VIDEO_LOC ((uint8_t *)0xB400)
 #define SCREEN_BAK 0xAB00
 #define PM_BASE 0xA000
 
+// With SHADOW_TILES, tiles are drawn to the shadow map and copied to VIDEO_LOC in waitvsync
+#ifdef SHADOW_TILES
+#define SCREEN_LOC shadowTiles
+#else
+#define SCREEN_LOC VIDEO_LOC
+#endif
+
 #define xypos(x, y) (SCREEN_LOC + x + (y) * WIDTH)
 
 #define TILE_SEA 0x38
@@ -33,7 +40,7 @@ extern unsigned char charset[];
 #define TILE_HIT_LEGOND 0x1C
 
 static uint8_t colorMode = 0, oldChbas = 0, colIndex = 0, fieldX = 0, playerCount, box_color = 0xff;
-static bool inGameCharSet = false;
+static bool inGameCharSet = false, savedInGameCharSet = false;
 static uint16_t lastCursor[] = {0, PM_BASE + 1024, PM_BASE + 1024, PM_BASE + 1024};
 
 static uint16_t quadrant_offset[] = {
@@ -47,7 +54,7 @@ uint8_t legendShipOffset[] = {2, 1, 0, 40 * 5, 40 * 6 + 1};
 void DisplayList =
     {
         DL_BLK8, DL_BLK8,                                                     // 2 Blanks Lines
-        DL_LMS(DL_CHR40x8x4), SCREEN_LOC,                                     // 1 Line
+        DL_LMS(DL_CHR40x8x4), VIDEO_LOC,                                      // 1 Line
         DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, // 5 Lines
         DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, // 5 Lines
         DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, DL_CHR40x8x4, // 5 Lines
@@ -135,16 +142,40 @@ void initGraphics()
     memcpy(&OS.pcolr0, &colors[colIndex + 1], 9);
 }
 
+void setInGameCharSet()
+{
+    static uint8_t *dest;
+
+    // Invert 0-9 & A-Z characters for in-game charset
+    inGameCharSet = true;
+
+    dest = CHARSET_LOC + 0x01 * 8;
+    while (dest < CHARSET_LOC + 0x5b * 8)
+    {
+        *dest = *dest ^ 0xff | 0b01010101;
+        dest++;
+        if (dest == CHARSET_LOC + 0x1A * 8)
+            dest = CHARSET_LOC + 0x40 * 8;
+        if (dest == CHARSET_LOC + 0x02 * 8)
+            dest = CHARSET_LOC + 0x10 * 8;
+    }
+}
+
 bool saveScreenBuffer()
 {
-    return false;
-    // memcpy(SCREEN_BAK, SCREEN_LOC, WIDTH * HEIGHT);
+    // The snapshot sits between player missile memory and the charset
+    memcpy((void *)SCREEN_BAK, SCREEN_LOC, WIDTH * HEIGHT);
+    savedInGameCharSet = inGameCharSet;
+    return true;
 }
 
 void restoreScreenBuffer()
 {
-    // waitvsync();
-    // memcpy(SCREEN_LOC, SCREEN_BAK, WIDTH * HEIGHT);
+    waitvsync();
+    if (savedInGameCharSet && !inGameCharSet)
+        setInGameCharSet();
+    memcpy(SCREEN_LOC, (void *)SCREEN_BAK, WIDTH * HEIGHT);
+    shadowTouch(0, HEIGHT);
 }
 
 void drawText(unsigned char x, unsigned char y, const char *s)
@@ -163,6 +194,7 @@ void drawText(unsigned char x, unsigned char y, const char *s)
             c = 0x40;
         *pos++ = c;
     }
+    shadowTouch(y, 1);
 }
 
 void drawTextAlt(unsigned char x, unsigned char y, const char *s)
@@ -184,12 +216,14 @@ void drawTextAlt(unsigned char x, unsigned char y, const char *s)
 
         *pos++ = c;
     }
+    shadowTouch(y, 1);
 }
 
 void resetScreen()
 {
     waitvsync();
     memset((void *)SCREEN_LOC, 0, WIDTH * HEIGHT);
+    shadowTouch(0, HEIGHT);
     if (inGameCharSet)
     {
         // Restore normal charset
@@ -204,26 +238,31 @@ void resetScreen()
 void drawIcon(unsigned char x, unsigned char y, unsigned char icon)
 {
     POKE(xypos(x, y), icon);
+    shadowTouch(y, 1);
 }
 
 void drawBlank(unsigned char x, unsigned char y)
 {
     POKE(xypos(x, y), 0);
+    shadowTouch(y, 1);
 }
 
 void drawSpace(unsigned char x, unsigned char y, unsigned char w)
 {
     memset(xypos(x, y), 0, w);
+    shadowTouch(y, 1);
 }
 
 void drawClock()
 {
     POKE(xypos(WIDTH - 1, HEIGHT - 1), 0x1D);
+    shadowTouch(HEIGHT - 1, 1);
 }
 
 void drawConnectionIcon(bool show)
 {
     POKEW(xypos(0, HEIGHT - 1), show ? 0x1f1e : 0);
+    shadowTouch(HEIGHT - 1, 1);
 }
 
 void drawTextAdd(uint8_t *dest, const char *s, uint8_t add)
@@ -246,6 +285,9 @@ void drawPlayerName(uint8_t player, const char *name, bool active)
     uint8_t *dest = SCREEN_LOC + fieldX + quadrant_offset[player] - WIDTH - 1;
     add = active ? 0 : 128;
 
+    // From the border above the name label of top boards, to the one below the label of bottom boards
+    shadowTouchAt(dest - WIDTH, 14);
+
     // Draw top and bottom borders and name label
     if (player == 0 || player == 3)
     {
@@ -356,21 +398,7 @@ void drawBoard(uint8_t currentPlayerCount)
     fieldX = playerCount > 2 ? 0 : 7;
 
     if (playerCount > 1 && !inGameCharSet)
-    {
-        // Invert 0-9 & A-Z characters for in-game charset
-        inGameCharSet = true;
-
-        dest = CHARSET_LOC + 0x01 * 8;
-        while (dest < CHARSET_LOC + 0x5b * 8)
-        {
-            *dest = *dest ^ 0xff | 0b01010101;
-            dest++;
-            if (dest == CHARSET_LOC + 0x1A * 8)
-                dest = CHARSET_LOC + 0x40 * 8;
-            if (dest == CHARSET_LOC + 0x02 * 8)
-                dest = CHARSET_LOC + 0x10 * 8;
-        }
-    }
+        setInGameCharSet();
 
     for (i = 0; i < playerCount; i++)
     {
@@ -385,6 +413,9 @@ void drawBoard(uint8_t currentPlayerCount)
             memset(dest + y * WIDTH, TILE_SEA, 10);
         }
 
+        // Gamefield rows, which also hold the drawer. drawPlayerName() spans them only in passing
+        shadowTouchAt(dest, 10);
+
         // Blue drawer
         if (i > 1 || (i > 0 && fieldX > 0))
         {
@@ -407,6 +438,7 @@ void drawBoard(uint8_t currentPlayerCount)
 void drawLine(unsigned char x, unsigned char y, unsigned char w)
 {
     memset(xypos(x, y), 0x3F, w);
+    shadowTouch(y, 1);
 }
 
 void drawShipInternal(uint8_t *dest, uint8_t size, uint8_t delta)
@@ -449,6 +481,7 @@ void drawShip(uint8_t quadrant, uint8_t size, uint8_t pos, bool hide)
     }
 
     dest = xypos((pos % 10), (pos / 10)) + fieldX + quadrant_offset[quadrant];
+    shadowTouchAt(dest, delta ? size : 1);
 
     if (hide)
     {
@@ -476,6 +509,7 @@ void drawLegendShip(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
     {
         dest += WIDTH - 4;
     }
+    shadowTouchAt(dest, size);
 
     if (status)
     {
@@ -493,6 +527,7 @@ void drawGamefield(uint8_t quadrant, uint8_t *field)
     static uint8_t y, x;
     uint8_t *dest = SCREEN_LOC + quadrant_offset[quadrant] + fieldX;
 
+    shadowTouchAt(dest, 10);
     for (y = 0; y < 10; ++y)
     {
         for (x = 0; x < 10; ++x)
@@ -515,6 +550,7 @@ void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos
     uint8_t *dest = SCREEN_LOC + quadrant_offset[quadrant] + fieldX + (uint16_t)(attackPos / 10) * WIDTH + (attackPos % 10);
     uint8_t c = gamefield[attackPos];
 
+    shadowTouchAt(dest, 1);
     if (cursorVisible)
     {
         cursorVisible = false;
@@ -562,6 +598,7 @@ void drawEndgameMessage(const char *message)
     memset(xypos(0, HEIGHT - 2), 0x62, WIDTH);
     memset(xypos(0, HEIGHT - 1), 0x40, x);
     memset(xypos(x + i, HEIGHT - 1), 0x40, WIDTH - x - i);
+    shadowTouch(HEIGHT - 2, 2);
     drawText(x, HEIGHT - 1, message);
 }
 
@@ -573,7 +610,22 @@ void drawBox(unsigned char x, unsigned char y, unsigned char w, unsigned char h)
     pos[w + 1] = 0x3c;
     pos[h * WIDTH + WIDTH] = 0x3d;
     pos[w + h * WIDTH + WIDTH + 1] = 0x3e;
+    shadowTouch(y, h + 2);
+}
+
+#ifdef SHADOW_TILES
+// In place of the library's waitvsync. The OS bumps the clock at the start of the
+// vertical blank, so changed rows are copied before the beam reaches the screen
+void waitvsync()
+{
+    static uint8_t frame;
+
+    frame = OS.rtclok[2];
+    while (OS.rtclok[2] == frame)
+        ;
+    shadowFlush(VIDEO_LOC);
 }
+#endif
 
 void resetGraphics()
 {
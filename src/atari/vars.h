@@ -22,6 +22,11 @@
 #define TIMER_NUM_OFFSET_X 0
 #define TIMER_NUM_OFFSET_Y 0
 
+// Draw to a shadow tile map, copied to the screen in the vertical blank (see shadow.h).
+// Off by default, as it takes WIDTH * HEIGHT bytes below $9A1F (see graphics.c)
+// #define SHADOW_TILES
+// #define SHADOW_FLUSH_ROWS 8
+
 // Icons
 #define ICON_TEXT_CURSOR 0x3A
 #define ICON_MARK 0x2B
@@ -59,49 +59,58 @@ appkeyC64 appkey;
 #define FUJICMD_WRITE_APPKEY 0xDE
 #define FUJICMD_READ_APPKEY 0xDD
 
+// Frames to wait for the bridge before a call fails (15 seconds)
+#define BRIDGE_TIMEOUT_FRAMES 900
+
 #ifdef CUSTOM_FUJINET_CALLS 
 
-int16_t custom_network_call(char *url, uint8_t *buffer, uint16_t max_len)
+uint8_t custom_network_open(char *url)
 {
-    int16_t count;
-    int8_t  i, wait;
+    static const char cr = 13;
+    static uint16_t wait;
 
-    // Delete existing file
+    // Delete existing response
     cbm_open(15,11,15, "s:vice-in"); 
+    cbm_close(15);
 
-    // Write command file (currently just the url )
+    // Write command file: the url, then a CR so the bridge knows the command is complete
     cbm_open(N_LFN,11,1,"vice-out"); 
     cbm_write(N_LFN, url, strlen(url)); 
+    cbm_write(N_LFN, &cr, 1);
     cbm_close(N_LFN);
 
-    // Wait until command file no longer exists (signifies a response is ready) */
-    buffer[0]=0; 
-    wait=0; 
-    count = 1;
-    while (count != 0 ) {
+    // Wait until command file no longer exists (signifies a response is ready).
+    // The bridge answers as soon as the file is closed, so check every frame
+    for (wait = 0; ; ++wait) {
 
-        // If we timed out (>15 seconds), return false 
-        wait++; 
-        if (wait > 90) {
-        return 0;
+        // If we timed out, return an error
+        if (wait > BRIDGE_TIMEOUT_FRAMES) {
+        return 1;
         }
 
-        // Short delay
-        for (i=0;i<10;i++) { 
         waitvsync(); 
-        } 
 
         // Check if file exists by renaming it
-        count = cbm_open(15,11,15, "r0:vice-out=vice-out"); 
+        if (!cbm_open(15,11,15, "r0:vice-out=vice-out")) {
+            cbm_close(15); 
+            break;
+        }
         cbm_close(15); 
     } 
 
-    // Read the response into the buffer 
+    // Open the response for reading
     cbm_open(N_LFN,11,0,"vice-in"); 
-    count = cbm_read(N_LFN,buffer, max_len); 
-    cbm_close(N_LFN); 
+    return 0;
+}
 
-    return count;
+int16_t custom_network_read(uint8_t *buffer, uint16_t len)
+{
+    return cbm_read(N_LFN, buffer, len);
+}
+
+void custom_network_close()
+{
+    cbm_close(N_LFN);
 }
 
 unsigned char open_appkey(unsigned char open_mode, unsigned int creator_id, unsigned char app_id, char key_id)
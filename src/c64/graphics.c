@@ -12,6 +12,7 @@ extern void irqVsyncWait(void);
 #define SCREEN_LOC ((uint8_t *)0xCC00)
 #define COLOR_LOC ((uint8_t *)0xD800)
 #define CHARSET_LOC 0xC000
+#define SCREEN_BAK ((uint8_t *)0xC800) // Free 1K between the charset and the screen
 
 #define xypos(x, y) (SCREEN_LOC + x + (y) * WIDTH)
 #define colorpos(x, y) (COLOR_LOC + x + (y) * WIDTH)
@@ -115,6 +116,9 @@ static const uint8_t cursorSprite[] = {
 
 static bool cursorVisible = false;
 
+// Color RAM snapshot, two 4 bit colors per byte
+static uint8_t colorBak[500];
+
 static uint16_t quadrant_offset[] = {
     WIDTH * 14 + 8,
     WIDTH * 2 + 8,
@@ -209,11 +213,36 @@ void resetGraphics()
 
 bool saveScreenBuffer()
 {
-    return false;
+    static uint16_t i;
+    static uint8_t *col;
+
+    memcpy(SCREEN_BAK, SCREEN_LOC, 1000);
+
+    // Only the low nibble of color RAM is wired
+    col = COLOR_LOC;
+    for (i = 0; i < 500; i++)
+    {
+        colorBak[i] = (col[0] & 0x0F) | (col[1] << 4);
+        col += 2;
+    }
+    return true;
 }
 
 void restoreScreenBuffer()
 {
+    static uint16_t i;
+    static uint8_t *col;
+
+    waitvsync();
+    memcpy(SCREEN_LOC, SCREEN_BAK, 1000);
+
+    col = COLOR_LOC;
+    for (i = 0; i < 500; i++)
+    {
+        col[0] = colorBak[i];
+        col[1] = colorBak[i] >> 4;
+        col += 2;
+    }
 }
 
 void drawText(unsigned char x, unsigned char y, const char *s)
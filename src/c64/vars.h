@@ -35,6 +35,9 @@
 #define CUSTOM_FUJINET_CALLS
 #endif
 
+// String literals are PETSCII, so raw HTTP requests over TCP are not possible
+#define DISABLE_KEEPALIVE
+
 /**
  * Platform specific key map for common input
  */
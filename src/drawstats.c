@@ -0,0 +1,446 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#include "misc.h"
+#define DRAWSTATS_C
+#include "drawstats.h"
+
+#ifdef DRAW_STATS
+
+typedef struct
+{
+    uint16_t calls, cells, jiffies;
+} DrawStat;
+
+static DrawStat drawStats[DRAW_STATS_SCREENS][DRAW_STATS_ENTRIES];
+static uint8_t screen, menuCovers;
+static uint16_t startTime;
+
+// Counted since the overlay was last drawn
+static uint16_t overlayCalls, overlayCells, overlayJiffies, overlayTime;
+
+static const char *const screenLabel[] = {"ot", "lb", "pl", "gb", "mn"};
+
+/// @brief Adds n to a counter, stopping at the largest value rather than wrapping
+static void addStat(uint16_t *counter, uint16_t n)
+{
+    *counter = n > 0xFFFF - *counter ? 0xFFFF : *counter + n;
+}
+
+static void statBegin()
+{
+    startTime = getTime();
+}
+
+static void statEnd(uint8_t entry, uint16_t cells)
+{
+    static DrawStat *stat;
+    static uint16_t jiffies;
+
+    // resetTimer() may have been called in between by the countdown, so never go below zero
+    jiffies = getTime() - startTime;
+    if (jiffies > 0x8000)
+        jiffies = 0;
+
+    stat = &drawStats[screen][entry];
+    addStat(&stat->calls, 1);
+    addStat(&stat->cells, cells);
+    addStat(&stat->jiffies, jiffies);
+
+    if (entry != DS_WAITVSYNC && entry != DS_PAUSE)
+    {
+        addStat(&overlayCalls, 1);
+        addStat(&overlayCells, cells);
+        addStat(&overlayJiffies, jiffies);
+    }
+}
+
+void drawStatsScreen(uint8_t newScreen)
+{
+    if (newScreen == DRAW_STATS_MENU)
+        menuCovers = screen;
+    screen = newScreen == DRAW_STATS_RESUME ? menuCovers : newScreen;
+}
+
+/// @brief Appends a label and value to tempBuffer
+static void overlayValue(char label, uint16_t value)
+{
+    static uint8_t len;
+
+    len = (uint8_t)strlen(tempBuffer);
+    tempBuffer[len++] = ' ';
+    tempBuffer[len++] = label;
+    itoa(value, tempBuffer + len, 10);
+}
+
+void drawStatsOverlay()
+{
+    static uint16_t now;
+    static uint8_t len;
+
+    if (!prefs.debugFlag)
+        return;
+
+    now = getTime();
+    if ((uint16_t)(now - overlayTime) < getJiffiesPerSecond())
+        return;
+    overlayTime = now;
+
+    strcpy(tempBuffer, screenLabel[screen]);
+    overlayValue('c', overlayCalls);
+    overlayValue('n', overlayCells);
+    overlayValue('v', overlayJiffies);
+
+    // Pad to a fixed width, to cover a longer line drawn before
+    len = (uint8_t)strlen(tempBuffer);
+    while (len < 22)
+        tempBuffer[len++] = ' ';
+    tempBuffer[len] = 0;
+
+    // Not counted, as it calls the platform directly
+    drawText(2, HEIGHT - 1, tempBuffer);
+    overlayCalls = overlayCells = overlayJiffies = 0;
+}
+
+void drawStatsDump()
+{
+    static uint8_t s, e, len, key;
+    static DrawStat *stat;
+
+    key = AK_KEY_DRAW_STATS;
+    len = 0;
+    for (s = 0; s < DRAW_STATS_SCREENS; s++)
+    {
+        for (e = 0; e < DRAW_STATS_ENTRIES; e++)
+        {
+            // Most entries are never called on a given screen, so leave them out
+            stat = &drawStats[s][e];
+            if (!stat->calls)
+                continue;
+
+            tempBuffer[len++] = (char)(s * DRAW_STATS_ENTRIES + e);
+            tempBuffer[len++] = (char)stat->calls;
+            tempBuffer[len++] = (char)(stat->calls >> 8);
+            tempBuffer[len++] = (char)stat->cells;
+            tempBuffer[len++] = (char)(stat->cells >> 8);
+            tempBuffer[len++] = (char)stat->jiffies;
+            tempBuffer[len++] = (char)(stat->jiffies >> 8);
+
+            if (len == DRAW_STATS_PER_KEY * DRAW_STATS_RECORD)
+            {
+                write_appkey(AK_CREATOR_ID, AK_APP_ID, key++, len, tempBuffer);
+                len = 0;
+            }
+        }
+    }
+
+    // A key that is not full ends the list, even if it is empty
+    write_appkey(AK_CREATOR_ID, AK_APP_ID, key, len, tempBuffer);
+}
+
+/*
+ * Wrappers
+ * Cells are those the arguments ask for. Platforms that also draw borders or
+ * padding around them touch more.
+ */
+
+void resetScreenStat()
+{
+    statBegin();
+    resetScreen();
+    statEnd(DS_RESET_SCREEN, WIDTH * HEIGHT);
+}
+
+uint8_t cycleNextColorStat()
+{
+    static uint8_t result;
+
+    statBegin();
+    result = cycleNextColor();
+    statEnd(DS_CYCLE_NEXT_COLOR, 0);
+    return result;
+}
+
+void drawTextStat(uint8_t x, uint8_t y, const char *s)
+{
+    statBegin();
+    drawText(x, y, s);
+    statEnd(DS_DRAW_TEXT, (uint16_t)strlen(s));
+}
+
+void drawTextAltStat(uint8_t x, uint8_t y, const char *s)
+{
+    statBegin();
+    drawTextAlt(x, y, s);
+    statEnd(DS_DRAW_TEXT_ALT, (uint16_t)strlen(s));
+}
+
+void drawIconStat(uint8_t x, uint8_t y, uint8_t icon)
+{
+    statBegin();
+    drawIcon(x, y, icon);
+    statEnd(DS_DRAW_ICON, 1);
+}
+
+void drawShipStat(uint8_t quadrant, uint8_t size, uint8_t pos, bool hide)
+{
+    statBegin();
+    drawShip(quadrant, size, pos, hide);
+    statEnd(DS_DRAW_SHIP, size);
+}
+
+void drawLegendShipStat(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
+{
+    statBegin();
+    drawLegendShip(player, index, size, status);
+    statEnd(DS_DRAW_LEGEND_SHIP, size);
+}
+
+void drawPlayerNameStat(uint8_t player, const char *name, bool active)
+{
+    statBegin();
+    drawPlayerName(player, name, active);
+    statEnd(DS_DRAW_PLAYER_NAME, (uint16_t)strlen(name));
+}
+
+void drawEndgameMessageStat(const char *message)
+{
+    statBegin();
+    drawEndgameMessage(message);
+    statEnd(DS_DRAW_ENDGAME_MESSAGE, (uint16_t)strlen(message));
+}
+
+void drawGamefieldStat(uint8_t quadrant, uint8_t *field)
+{
+    statBegin();
+    drawGamefield(quadrant, field);
+    statEnd(DS_DRAW_GAMEFIELD, 100);
+}
+
+void drawGamefieldUpdateStat(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim)
+{
+    statBegin();
+    drawGamefieldUpdate(quadrant, gamefield, attackPos, anim);
+    statEnd(DS_DRAW_GAMEFIELD_UPDATE, 1);
+}
+
+void drawGamefieldCursorStat(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefield, uint8_t blink)
+{
+    statBegin();
+    drawGamefieldCursor(quadrant, x, y, gamefield, blink);
+    statEnd(DS_DRAW_GAMEFIELD_CURSOR, 1);
+}
+
+void drawClockStat()
+{
+    statBegin();
+    drawClock();
+    statEnd(DS_DRAW_CLOCK, 1);
+}
+
+void drawConnectionIconStat(bool show)
+{
+    statBegin();
+    drawConnectionIcon(show);
+    statEnd(DS_DRAW_CONNECTION_ICON, 1);
+}
+
+void drawBlankStat(uint8_t x, uint8_t y)
+{
+    statBegin();
+    drawBlank(x, y);
+    statEnd(DS_DRAW_BLANK, 1);
+}
+
+void drawSpaceStat(uint8_t x, uint8_t y, uint8_t w)
+{
+    statBegin();
+    drawSpace(x, y, w);
+    statEnd(DS_DRAW_SPACE, w);
+}
+
+void drawLineStat(uint8_t x, uint8_t y, uint8_t w)
+{
+    statBegin();
+    drawLine(x, y, w);
+    statEnd(DS_DRAW_LINE, w);
+}
+
+void drawBoxStat(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+    statBegin();
+    drawBox(x, y, w, h);
+    statEnd(DS_DRAW_BOX, (w + h) * 2 + 4);
+}
+
+void drawBoardStat(uint8_t playerCount)
+{
+    statBegin();
+    drawBoard(playerCount);
+
+    // Each gamefield, and the drawer beside it
+    statEnd(DS_DRAW_BOARD, playerCount * (100 + 3 * 8));
+}
+
+bool saveScreenBufferStat()
+{
+    static bool result;
+
+    statBegin();
+    result = saveScreenBuffer();
+    statEnd(DS_SAVE_SCREEN_BUFFER, result ? WIDTH * HEIGHT : 0);
+    return result;
+}
+
+void restoreScreenBufferStat()
+{
+    statBegin();
+    restoreScreenBuffer();
+    statEnd(DS_RESTORE_SCREEN_BUFFER, WIDTH * HEIGHT);
+}
+
+void initGraphicsStat()
+{
+    statBegin();
+    initGraphics();
+    statEnd(DS_INIT_GRAPHICS, WIDTH * HEIGHT);
+}
+
+void resetGraphicsStat()
+{
+    statBegin();
+    resetGraphics();
+    statEnd(DS_RESET_GRAPHICS, WIDTH * HEIGHT);
+}
+
+void waitvsyncStat()
+{
+    statBegin();
+    waitvsync();
+    statEnd(DS_WAITVSYNC, 0);
+}
+
+void initSoundStat()
+{
+    statBegin();
+    initSound();
+    statEnd(DS_INIT_SOUND, 0);
+}
+
+void disableKeySoundsStat()
+{
+    statBegin();
+    disableKeySounds();
+    statEnd(DS_DISABLE_KEY_SOUNDS, 0);
+}
+
+void enableKeySoundsStat()
+{
+    statBegin();
+    enableKeySounds();
+    statEnd(DS_ENABLE_KEY_SOUNDS, 0);
+}
+
+void soundCursorStat()
+{
+    statBegin();
+    soundCursor();
+    statEnd(DS_SOUND_CURSOR, 0);
+}
+
+void soundSelectStat()
+{
+    statBegin();
+    soundSelect();
+    statEnd(DS_SOUND_SELECT, 0);
+}
+
+void soundStopStat()
+{
+    statBegin();
+    soundStop();
+    statEnd(DS_SOUND_STOP, 0);
+}
+
+void soundJoinGameStat()
+{
+    statBegin();
+    soundJoinGame();
+    statEnd(DS_SOUND_JOIN_GAME, 0);
+}
+
+void soundMyTurnStat()
+{
+    statBegin();
+    soundMyTurn();
+    statEnd(DS_SOUND_MY_TURN, 0);
+}
+
+void soundGameDoneStat()
+{
+    statBegin();
+    soundGameDone();
+    statEnd(DS_SOUND_GAME_DONE, 0);
+}
+
+void soundTickStat()
+{
+    statBegin();
+    soundTick();
+    statEnd(DS_SOUND_TICK, 0);
+}
+
+void soundPlaceShipStat()
+{
+    statBegin();
+    soundPlaceShip();
+    statEnd(DS_SOUND_PLACE_SHIP, 0);
+}
+
+void soundAttackStat()
+{
+    statBegin();
+    soundAttack();
+    statEnd(DS_SOUND_ATTACK, 0);
+}
+
+void soundInvalidStat()
+{
+    statBegin();
+    soundInvalid();
+    statEnd(DS_SOUND_INVALID, 0);
+}
+
+void soundHitStat()
+{
+    statBegin();
+    soundHit();
+    statEnd(DS_SOUND_HIT, 0);
+}
+
+void soundSinkStat()
+{
+    statBegin();
+    soundSink();
+    statEnd(DS_SOUND_SINK, 0);
+}
+
+void soundMissStat()
+{
+    statBegin();
+    soundMiss();
+    statEnd(DS_SOUND_MISS, 0);
+}
+
+void pauseStat(uint8_t frames)
+{
+    statBegin();
+    pause(frames);
+    statEnd(DS_PAUSE, 0);
+}
+
+#endif
@@ -0,0 +1,195 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#ifndef DRAWSTATS_H
+#define DRAWSTATS_H
+
+/*
+ * Draw stats
+ * Optional instrumentation of the graphics.h and sound.h entry points. Define DRAW_STATS in
+ * the platform's vars.h, and every call the game logic makes to them goes through a wrapper
+ * that counts the call, the cells it asks to draw and the jiffies that tick while it runs.
+ * The counts are kept per screen (lobby, placement, gameboard, menu, and other screens).
+ * Only calls from gamelogic.c, screens.c and main.c, which include this header, are counted.
+ *
+ * With prefs.debugFlag set, the bottom row shows the current screen's calls, cells and
+ * jiffies over the last second, not counting waitvsync() and pause().
+ *
+ * drawStatsDump() writes the totals since start to the AK_KEY_DRAW_STATS appkeys, at game
+ * over and when leaving a game. Only entries that were called are written, each as a
+ * record of its id (screen * DRAW_STATS_ENTRIES + entry) followed by calls, cells and
+ * jiffies (16 bits each, little endian, saturating). Records fill the keys in order,
+ * DRAW_STATS_PER_KEY to a key, and a key holding fewer ends the list, so a typical run
+ * takes a handful of writes. The Linux build writes appkeys to files, see
+ * support/drawstats/drawstats.py.
+ */
+
+#define DRAW_STATS_OTHER 0
+#define DRAW_STATS_LOBBY 1
+#define DRAW_STATS_PLACEMENT 2
+#define DRAW_STATS_GAMEBOARD 3
+#define DRAW_STATS_MENU 4   // Remembers the screen it covers
+#define DRAW_STATS_RESUME 5 // Back to the screen the menu covered
+#define DRAW_STATS_SCREENS 5
+
+// graphics.h
+#define DS_RESET_SCREEN 0
+#define DS_CYCLE_NEXT_COLOR 1
+#define DS_DRAW_TEXT 2
+#define DS_DRAW_TEXT_ALT 3
+#define DS_DRAW_ICON 4
+#define DS_DRAW_SHIP 5
+#define DS_DRAW_LEGEND_SHIP 6
+#define DS_DRAW_PLAYER_NAME 7
+#define DS_DRAW_ENDGAME_MESSAGE 8
+#define DS_DRAW_GAMEFIELD 9
+#define DS_DRAW_GAMEFIELD_UPDATE 10
+#define DS_DRAW_GAMEFIELD_CURSOR 11
+#define DS_DRAW_CLOCK 12
+#define DS_DRAW_CONNECTION_ICON 13
+#define DS_DRAW_BLANK 14
+#define DS_DRAW_SPACE 15
+#define DS_DRAW_LINE 16
+#define DS_DRAW_BOX 17
+#define DS_DRAW_BOARD 18
+#define DS_SAVE_SCREEN_BUFFER 19
+#define DS_RESTORE_SCREEN_BUFFER 20
+#define DS_INIT_GRAPHICS 21
+#define DS_RESET_GRAPHICS 22
+#define DS_WAITVSYNC 23
+
+// sound.h
+#define DS_INIT_SOUND 24
+#define DS_DISABLE_KEY_SOUNDS 25
+#define DS_ENABLE_KEY_SOUNDS 26
+#define DS_SOUND_CURSOR 27
+#define DS_SOUND_SELECT 28
+#define DS_SOUND_STOP 29
+#define DS_SOUND_JOIN_GAME 30
+#define DS_SOUND_MY_TURN 31
+#define DS_SOUND_GAME_DONE 32
+#define DS_SOUND_TICK 33
+#define DS_SOUND_PLACE_SHIP 34
+#define DS_SOUND_ATTACK 35
+#define DS_SOUND_INVALID 36
+#define DS_SOUND_HIT 37
+#define DS_SOUND_SINK 38
+#define DS_SOUND_MISS 39
+#define DS_PAUSE 40
+
+#define DRAW_STATS_ENTRIES 41
+#define DRAW_STATS_RECORD 7   // Entry id, calls, cells and jiffies
+#define DRAW_STATS_PER_KEY 9  // 63 bytes, within MAX_APPKEY_LEN
+#define DRAW_STATS_KEYS ((DRAW_STATS_SCREENS * DRAW_STATS_ENTRIES + DRAW_STATS_PER_KEY - 1) / DRAW_STATS_PER_KEY)
+
+#ifdef DRAW_STATS
+
+/// @brief Sets the screen the following calls are counted against
+void drawStatsScreen(uint8_t screen);
+
+/// @brief Draws the overlay once a second, if prefs.debugFlag is set
+void drawStatsOverlay();
+
+/// @brief Writes the totals to the draw stats appkeys
+void drawStatsDump();
+
+void resetScreenStat();
+uint8_t cycleNextColorStat();
+void drawTextStat(uint8_t x, uint8_t y, const char *s);
+void drawTextAltStat(uint8_t x, uint8_t y, const char *s);
+void drawIconStat(uint8_t x, uint8_t y, uint8_t icon);
+void drawShipStat(uint8_t quadrant, uint8_t size, uint8_t pos, bool hide);
+void drawLegendShipStat(uint8_t player, uint8_t index, uint8_t size, uint8_t status);
+void drawPlayerNameStat(uint8_t player, const char *name, bool active);
+void drawEndgameMessageStat(const char *message);
+void drawGamefieldStat(uint8_t quadrant, uint8_t *field);
+void drawGamefieldUpdateStat(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim);
+void drawGamefieldCursorStat(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefield, uint8_t blink);
+void drawClockStat();
+void drawConnectionIconStat(bool show);
+void drawBlankStat(uint8_t x, uint8_t y);
+void drawSpaceStat(uint8_t x, uint8_t y, uint8_t w);
+void drawLineStat(uint8_t x, uint8_t y, uint8_t w);
+void drawBoxStat(uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+void drawBoardStat(uint8_t playerCount);
+bool saveScreenBufferStat();
+void restoreScreenBufferStat();
+void initGraphicsStat();
+void resetGraphicsStat();
+void waitvsyncStat();
+
+void initSoundStat();
+void disableKeySoundsStat();
+void enableKeySoundsStat();
+void soundCursorStat();
+void soundSelectStat();
+void soundStopStat();
+void soundJoinGameStat();
+void soundMyTurnStat();
+void soundGameDoneStat();
+void soundTickStat();
+void soundPlaceShipStat();
+void soundAttackStat();
+void soundInvalidStat();
+void soundHitStat();
+void soundSinkStat();
+void soundMissStat();
+void pauseStat(uint8_t frames);
+
+// Route the callers' calls through the wrappers. Function-like, so state.drawBoard is left alone
+#ifndef DRAWSTATS_C
+#define resetScreen() resetScreenStat()
+#define cycleNextColor() cycleNextColorStat()
+#define drawText(x, y, s) drawTextStat(x, y, s)
+#define drawTextAlt(x, y, s) drawTextAltStat(x, y, s)
+#define drawIcon(x, y, icon) drawIconStat(x, y, icon)
+#define drawShip(quadrant, size, pos, hide) drawShipStat(quadrant, size, pos, hide)
+#define drawLegendShip(player, index, size, status) drawLegendShipStat(player, index, size, status)
+#define drawPlayerName(player, name, active) drawPlayerNameStat(player, name, active)
+#define drawEndgameMessage(message) drawEndgameMessageStat(message)
+#define drawGamefield(quadrant, field) drawGamefieldStat(quadrant, field)
+#define drawGamefieldUpdate(quadrant, gamefield, attackPos, anim) drawGamefieldUpdateStat(quadrant, gamefield, attackPos, anim)
+#define drawGamefieldCursor(quadrant, x, y, gamefield, blink) drawGamefieldCursorStat(quadrant, x, y, gamefield, blink)
+#define drawClock() drawClockStat()
+#define drawConnectionIcon(show) drawConnectionIconStat(show)
+#define drawBlank(x, y) drawBlankStat(x, y)
+#define drawSpace(x, y, w) drawSpaceStat(x, y, w)
+#define drawLine(x, y, w) drawLineStat(x, y, w)
+#define drawBox(x, y, w, h) drawBoxStat(x, y, w, h)
+#define drawBoard(playerCount) drawBoardStat(playerCount)
+#define saveScreenBuffer() saveScreenBufferStat()
+#define restoreScreenBuffer() restoreScreenBufferStat()
+#define initGraphics() initGraphicsStat()
+#define resetGraphics() resetGraphicsStat()
+#define waitvsync() waitvsyncStat()
+
+#define initSound() initSoundStat()
+#define disableKeySounds() disableKeySoundsStat()
+#define enableKeySounds() enableKeySoundsStat()
+#define soundCursor() soundCursorStat()
+#define soundSelect() soundSelectStat()
+#define soundStop() soundStopStat()
+#define soundJoinGame() soundJoinGameStat()
+#define soundMyTurn() soundMyTurnStat()
+#define soundGameDone() soundGameDoneStat()
+#define soundTick() soundTickStat()
+#define soundPlaceShip() soundPlaceShipStat()
+#define soundAttack() soundAttackStat()
+#define soundInvalid() soundInvalidStat()
+#define soundHit() soundHitStat()
+#define soundSink() soundSinkStat()
+#define soundMiss() soundMissStat()
+#define pause(frames) pauseStat(frames)
+#endif
+
+#else
+#define drawStatsScreen(screen)
+#define drawStatsOverlay()
+#define drawStatsDump()
+#endif
+
+#endif /* DRAWSTATS_H */
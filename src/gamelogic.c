@@ -9,6 +9,7 @@
 #include "gamelogic.h"
 #include "stateclient.h"
 #include "screens.h"
+#include "drawstats.h"
 
 #ifndef TIMER_WIDTH
 #define TIMER_WIDTH 1
@@ -19,21 +20,179 @@ uint8_t shipPlacements[5] = {0, 0, 0, 0, 0};
 uint8_t shipPlaceIndex = 0;
 char moveBuffer[32];
 
-void progressAnim(uint8_t y)
+typedef struct
+{
+    uint8_t type;    // ANIM_NONE when the slot is free
+    uint8_t step;    // Next step to draw
+    uint8_t count;   // Steps in all
+    uint8_t rate;    // Frames between steps
+    uint16_t wait;   // Frames until the next step
+    uint8_t a, b, c; // Depend on the type, see gamelogic.h
+} Animation;
+
+static Animation animations[ANIM_MAX];
+
+// Frames until the last queued effect ends, and set while skipping to silence sounds
+static uint16_t animEnd;
+static bool animQuiet;
+
+static void drawAnimationStep(Animation *anim)
+{
+    static uint8_t i, last;
+
+    last = anim->step == anim->count - 1;
+
+    switch (anim->type)
+    {
+    case ANIM_ATTACK:
+        for (i = 0; i < clientState.game.playerCount; i++)
+        {
+            if (anim->a & (1 << i))
+                drawGamefieldUpdate(i, clientState.game.players[i].gamefield, anim->b, 10 + anim->step);
+        }
+        break;
+
+    case ANIM_RESULT:
+        // Alternate between the two hit tiles, ending on the first
+        for (i = 0; i < clientState.game.playerCount; i++)
+        {
+            if (anim->a & (1 << i))
+                drawGamefieldUpdate(i, clientState.game.players[i].gamefield, anim->b, (anim->count - 1 - anim->step) & 1);
+        }
+
+        if (!animQuiet)
+        {
+            if (anim->step == 0)
+            {
+                if (anim->c > STATUS_MISS)
+                    soundHit();
+                else
+                    soundMiss();
+            }
+            if (last && anim->c == STATUS_SUNK)
+                soundSink();
+        }
+        break;
+
+    case ANIM_LEGEND:
+        // Ends on the destroyed ship
+        drawLegendShip(anim->a, anim->b, shipSize[anim->b], anim->step & 1);
+        if (last && anim->c && !animQuiet)
+            soundSink();
+        break;
+
+    case ANIM_BLINK:
+        // Leave the name alone once the turn has moved on
+        if (clientState.game.activePlayer == anim->a)
+            drawPlayerName(anim->a, clientState.game.players[anim->a].name, anim->step);
+        break;
+
+    case ANIM_PROGRESS:
+        drawIcon(WIDTH / 2 - 2 + anim->step * 2, anim->a, ICON_MARK);
+        break;
+    }
+}
+
+void handleAnimation()
 {
     static uint8_t i;
+    static Animation *anim;
 
-    for (i = 0; i < 3; ++i)
+    if (!animEnd)
+        return;
+
+    animEnd--;
+    for (i = 0; i < ANIM_MAX; i++)
     {
-        pause(10);
-        drawIcon(WIDTH / 2 - 2 + i * 2, y, ICON_MARK);
+        anim = &animations[i];
+        if (!anim->type)
+            continue;
+
+        if (anim->wait)
+        {
+            anim->wait--;
+            continue;
+        }
+
+        drawAnimationStep(anim);
+        if (++anim->step == anim->count)
+            anim->type = ANIM_NONE;
+        else
+            anim->wait = anim->rate - 1;
     }
 }
 
-void processStateChange()
+void queueAnimation(uint8_t type, uint16_t start, uint8_t count, uint8_t rate, uint8_t a, uint8_t b, uint8_t c)
 {
     static uint8_t i;
+    static Animation *anim;
+
+    for (i = 0; i < ANIM_MAX; i++)
+    {
+        if (!animations[i].type)
+            break;
+    }
+
+    // With no free slot, catch up on the effects already queued
+    if (i == ANIM_MAX)
+    {
+        skipAnimations();
+        i = 0;
+    }
 
+    anim = &animations[i];
+    anim->type = type;
+    anim->step = 0;
+    anim->count = count;
+    anim->rate = rate;
+    anim->wait = start;
+    anim->a = a;
+    anim->b = b;
+    anim->c = c;
+
+    start += count * rate;
+    if (start > animEnd)
+        animEnd = start;
+}
+
+uint16_t animationEnd()
+{
+    return animEnd;
+}
+
+void skipAnimations()
+{
+    // Run through the timeline without waiting on frames, so steps are drawn in order
+    animQuiet = true;
+    while (animEnd)
+        handleAnimation();
+    animQuiet = false;
+}
+
+void finishAnimations()
+{
+    while (animEnd)
+    {
+        waitvsync();
+        apiCallIdle();
+        handleAnimation();
+    }
+}
+
+void clearAnimations()
+{
+    memset(animations, 0, sizeof(animations));
+    animEnd = 0;
+}
+
+void progressAnim(uint8_t y)
+{
+    queueAnimation(ANIM_PROGRESS, 10, 3, 10, y, 0, 0);
+    finishAnimations();
+}
+
+void processStateChange()
+{
     switch (clientState.game.status)
     {
     case STATUS_LOBBY:
@@ -50,13 +209,8 @@ void processStateChange()
     state.prevActivePlayer = clientState.game.activePlayer;
     state.prevAttackPos = clientState.game.lastAttackPos;
 
-    if (clientState.game.status >= STATUS_GAMESTART)
-    {
-        for(i=0;i<clientState.game.playerCount;i++)
-        {
-            memcpy(&state.gamefield[i], &clientState.game.players[i].gamefield, 100);
-        }
-    } 
+    // The state on screen is now the one to compare the next against
+    stateShown();
 }
 
 #define READY_LEFT WIDTH / 2 - 8
@@ -66,13 +220,12 @@ void renderLobby()
     static uint8_t c = 0;
     uint8_t i, len;
 
+    drawStatsScreen(DRAW_STATS_LOBBY);
     if (clientState.game.status != state.prevStatus || state.drawBoard)
     {
         state.drawBoard = false;
-        
-        // Clear gamefield
-        memset(state.gamefield, 0, sizeof(state.gamefield));
 
+        clearAnimations();
         resetScreen();
 
         // Round 0 - Ready Up screen
@@ -120,7 +273,7 @@ void renderLobby()
                 drawSpace(READY_LEFT + len, 8 + i, 8 - len);
             }
             drawText(READY_LEFT, 8 + i, clientState.lobby.players[i].name);
-            if (clientState.lobby.players[i].ready)
+            if ((i == 0 && state.readyPending) ? state.readyWanted : clientState.lobby.players[i].ready)
             {
                 drawTextAlt(READY_LEFT + 11, 8 + i, "ready");
             }
@@ -143,6 +296,8 @@ void handleShipPlacement()
 {
     uint8_t i, x, y, dir, pos, size, change, blink, maxW, maxH, canPlace;
 
+    drawStatsScreen(DRAW_STATS_PLACEMENT);
+
     // Use tempBuffer to track occupied cells while placing ships
     memset(tempBuffer, 0, sizeof(tempBuffer));
 
@@ -279,11 +434,20 @@ void handleShipPlacement()
     sendMove(moveBuffer);
 }
 
+/// @brief Returns the name shown on the gameboard for a player in the given state
+static const char *boardName(ClientState *s, uint8_t player)
+{
+    return player == 0 && s->game.playerStatus != PLAYER_STATUS_VIEWING ? "you" : (const char *)s->game.players[player].name;
+}
+
 void renderGameboard()
 {
 #define LEGEND_X WIDTH / 2 + 8
-    static bool redraw, fullWidth;
-    uint8_t i, j, jj, x, y, dir, pos, size, playedSound, skipAnim = false;
+    static bool redraw, drawAll, drawn, active, fullWidth;
+    static AttackEvent *event;
+    uint8_t i, j, e, x, y, dir, pos, size, attacked, shown, fast, sunk = 0, skipAnim = false;
+
+    drawStatsScreen(clientState.game.status == STATUS_PLACE_SHIPS ? DRAW_STATS_PLACEMENT : DRAW_STATS_GAMEBOARD);
 
     // Redraw the entire board when placing ships back to round 0 (ready up)
     redraw = clientState.game.status != state.prevStatus && (clientState.game.status == STATE_INVALID || clientState.game.status == STATUS_PLACE_SHIPS || state.prevStatus == STATUS_PLACE_SHIPS);
@@ -294,6 +458,7 @@ void renderGameboard()
         state.drawBoard = false;
         redraw = true;
         skipAnim = true;
+        clearAnimations();
         resetScreen();
         drawBoard(clientState.game.status == STATUS_PLACE_SHIPS ? 1 : clientState.game.playerCount);
 
@@ -321,114 +486,138 @@ void renderGameboard()
         }
     }
 
+    // Otherwise only what differs from the state on screen (prevState) is drawn. Legend ships, names
+    // and placed ships are drawn in full on leaving the lobby, as prevState then holds the lobby's
+    // layout, and at game over or when the player count changes. Anything drawn is given time to be seen
+    drawAll = redraw || clientState.game.playerCount != state.prevPlayerCount ||
+              (clientState.game.status != state.prevStatus && (clientState.game.status == STATUS_GAMEOVER || state.prevStatus < STATUS_GAMESTART));
+    drawn = drawAll;
+
     if (clientState.game.status >= STATUS_GAMESTART)
     {
-        if (clientState.game.activePlayer == state.prevActivePlayer || clientState.game.status == STATUS_GAMESTART)
+        if (clientState.game.status == STATUS_GAMESTART)
         {
             skipAnim = true;
         }
 
-        playedSound = skipAnim;
+        // A freshly drawn board already shows every attack
+        if (skipAnim)
+        {
+            state.eventCount = 0;
+        }
 
         // Render gamefield updates
         if (clientState.game.status > STATUS_GAMESTART)
         {
-
-            // Animate other player's attack
-            if (!skipAnim && state.prevActivePlayer != 0)
+            // Queue each attack since the last update to play back in order, after any still playing.
+            // Compressed when there is a backlog
+            fast = state.eventCount > 2 || animationEnd() > ANIM_BACKLOG;
+            for (e = 0; e < state.eventCount; e++)
             {
-                for (j = 10; j < 16; j++)
+                drawn = true;
+                event = &state.events[e];
+                pos = event->pos;
+
+                // Boards to animate
+                attacked = shown = 0;
+                for (i = 0; i < clientState.game.playerCount; i++)
                 {
-                    for (i = 0; i < clientState.game.playerCount; i++)
+                    if (i != event->attacker && prevState.game.players[i].gamefield[pos] == 0)
                     {
-                        if (i != state.prevActivePlayer && clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && state.gamefield[i][clientState.game.lastAttackPos] == 0 )
-                            drawGamefieldUpdate(i, clientState.game.players[i].gamefield, clientState.game.lastAttackPos, j);
+                        shown |= 1 << i;
+                        if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
+                            attacked |= 1 << i;
                     }
-                    pause(5);
                 }
-            }
 
-            // Animate/render hit/miss
-            for (j = (!skipAnim && clientState.game.status == STATUS_HIT) * 6; j < 255; --j)
-            {
+                // Animate other player's attack
+                if (event->attacker != 0)
+                {
+                    queueAnimation(ANIM_ATTACK, animationEnd(), 6, fast ? 1 : 5, attacked, pos, 0);
+                }
+
+                // Animate/render hit/miss
+                queueAnimation(ANIM_RESULT, animationEnd(), (!fast && event->status == STATUS_HIT) ? 7 : 1, fast ? 1 : 4, shown, pos, event->status);
+
+                if (event->status == STATUS_SUNK)
+                {
+                    sunk++;
+                }
+
+                // Mark the cell as shown, so a later attack on the same spot only animates the rest
                 for (i = 0; i < clientState.game.playerCount; i++)
                 {
-                    if (i != state.prevActivePlayer && state.gamefield[i][clientState.game.lastAttackPos] == 0)
-                        drawGamefieldUpdate(i, clientState.game.players[i].gamefield, clientState.game.lastAttackPos, j & 1);
+                    if (i != event->attacker)
+                        prevState.game.players[i].gamefield[pos] = clientState.game.players[i].gamefield[pos];
                 }
-                if (!playedSound)
+            }
+            state.eventCount = 0;
+
+            // Draw any attack missing from the event log, e.g. dropped from a long backlog
+            if (!redraw)
+            {
+                for (i = 0; i < clientState.game.playerCount; i++)
                 {
-                    if (clientState.game.status > STATUS_MISS)
+                    for (pos = 0; pos < 100; pos++)
                     {
-                        soundHit();
+                        if (prevState.game.players[i].gamefield[pos] != clientState.game.players[i].gamefield[pos])
+                        {
+                            drawGamefieldUpdate(i, clientState.game.players[i].gamefield, pos, 0);
+                            drawn = true;
+                        }
                     }
-                    else
-                    {
-                        soundMiss();
-                    }
-                    playedSound = 1;
                 }
-
-                pause(4);
             }
         }
 
         for (i = 0; i < clientState.game.playerCount; i++)
         {
-            // Draw ships left indicators on legend
+            // Draw ships left indicators on legend, only those that changed unless redrawing
             for (j = 0; j < 5; j++)
             {
-                // Animate a ship being sunk
-                if (!skipAnim && state.shipsLeft[i][j] != clientState.game.players[i].shipsLeft[j])
+                if (!drawAll && prevState.game.players[i].shipsLeft[j] == clientState.game.players[i].shipsLeft[j])
+                    continue;
+
+                drawn = true;
+
+                // Animate a ship being sunk, once the attacks have played. Sinks from the event log
+                // already play their sound
+                if (!skipAnim && prevState.game.players[i].shipsLeft[j] != clientState.game.players[i].shipsLeft[j])
                 {
-                    for (jj = 0; jj < 5; jj++)
+                    queueAnimation(ANIM_LEGEND, animationEnd() + 4, 5, 4, i, j, !sunk);
+                    if (sunk)
                     {
-                        pause(4);
-                        drawLegendShip(i, j, shipSize[j], jj & 1);
+                        sunk--;
                     }
-
-                    soundSink();
                 }
                 else
                 {
                     drawLegendShip(i, j, shipSize[j], clientState.game.players[i].shipsLeft[j]);
                 }
             }
-
-            // Track current ships left so we can animate when a ship gets sunk
-            memcpy(state.shipsLeft[i], clientState.game.players[i].shipsLeft, 5);
         }
 
-        if (clientState.game.status != STATUS_GAMEOVER || redraw || clientState.game.status != state.prevStatus)
+        if (clientState.game.status != STATUS_GAMEOVER || drawAll)
         {
-            // Clear active player
             for (i = 0; i < clientState.game.playerCount; i++)
             {
-                // Draw player name
-                if (i != clientState.game.activePlayer)
-                    drawPlayerName(i, i == 0 && clientState.game.playerStatus != PLAYER_STATUS_VIEWING ? "you" : (const char *)clientState.game.players[i].name, false);
-            }
+                // The winner keeps the active marker at game over
+                active = i == clientState.game.activePlayer;
+                if (active && clientState.game.status == STATUS_GAMEOVER)
+                    continue;
 
-            // Indicate active player if not game over
-            if (clientState.game.status != STATUS_GAMEOVER)
-            {
-                // Show active player
-                if (clientState.game.activePlayer >= 0)
+                // Draw player name, if it or the active marker changed
+                if (drawAll || active != (i == state.prevActivePlayer) || strcmp(boardName(&prevState, i), boardName(&clientState, i)))
                 {
-                    drawPlayerName(clientState.game.activePlayer, clientState.game.activePlayer == 0 && clientState.game.playerStatus != PLAYER_STATUS_VIEWING ? "you" : (const char *)clientState.game.players[clientState.game.activePlayer].name, true);
+                    drawPlayerName(i, boardName(&clientState, i), active);
+                    drawn = true;
                 }
+            }
 
-                // Blink active player
-                if (clientState.game.activePlayer > 0)
-                {
-
-                    pause(15);
-                    drawPlayerName(clientState.game.activePlayer, clientState.game.players[clientState.game.activePlayer].name, false);
-
-                    pause(15);
-                    drawPlayerName(clientState.game.activePlayer, clientState.game.players[clientState.game.activePlayer].name, true);
-                    pause(15);
-                }
+            // Blink the active player when the turn passes to another player
+            if (clientState.game.status != STATUS_GAMEOVER && clientState.game.activePlayer > 0 && clientState.game.activePlayer != state.prevActivePlayer)
+            {
+                queueAnimation(ANIM_BLINK, animationEnd() + 15, 2, 15, clientState.game.activePlayer, 0, 0);
             }
         }
     }
@@ -436,6 +625,9 @@ void renderGameboard()
     // Display the gameover message and play a sound if the state just changed
     if (clientState.game.status == STATUS_GAMEOVER && (redraw || clientState.game.status != state.prevStatus))
     {
+        // Let the last attack play out first
+        finishAnimations();
+
         // Reveal winning player's ships (if not this player)
         waitvsync();
         if (clientState.game.activePlayer > 0)
@@ -453,6 +645,7 @@ void renderGameboard()
         if (clientState.game.status != state.prevStatus)
         {
             soundGameDone();
+            drawStatsDump();
 
             // Wait for user to press button to close game result
             clearCommonInput();
@@ -473,22 +666,30 @@ void renderGameboard()
             {
                 handleShipPlacement();
             }
-            else
+            else if (drawAll || clientState.game.playerStatus != state.prevPlayerStatus || memcmp(prevState.game.myShips, clientState.game.myShips, 5))
             {
                 // Draw already placed ships from game state
                 for (i = 0; i < 5; i++)
                 {
                     drawShip(0, shipSize[i], clientState.game.myShips[i], DRAWSHIP_SHOW);
                 }
+                drawn = true;
             }
         }
-        if (clientState.game.status == STATUS_PLACE_SHIPS)
+        if (clientState.game.status == STATUS_PLACE_SHIPS && (drawAll || strcmp(prevState.game.prompt, clientState.game.prompt)))
         {
             centerTextWide(5, clientState.game.prompt);
             centerTextAlt(7, "                   ");
+            drawn = true;
         }
     }
-    pause(30);
+
+    // Give anything drawn time to be seen before the next effect or this player's turn.
+    // A poll that changed nothing on screen costs no frames
+    if (drawn)
+    {
+        queueAnimation(ANIM_HOLD, animationEnd(), 1, 30, 0, 0, 0);
+    }
     // cgetc();
     // pause(60);
 }
@@ -537,22 +738,25 @@ void processInput()
         // Toggle readiness if waiting to start game
         if (clientState.game.status == STATUS_LOBBY && input.trigger)
         {
-            clientState.lobby.playerStatus = clientState.lobby.playerStatus ? PLAYER_STATUS_DEFAULT : PLAYER_STATUS_READY;
-            clientState.lobby.players[0].ready = clientState.lobby.playerStatus;
+            // Show the change right away. Repeated toggles coalesce, and the poll loop sends the result
+            state.readyWanted = !(state.readyPending ? state.readyWanted : clientState.lobby.playerStatus == PLAYER_STATUS_READY);
+            state.readyPending = true;
+            state.readySent = false;
+            state.apiCallWait = 0;
             renderLobby();
 
-            if (clientState.lobby.playerStatus)
+            if (state.readyWanted)
                 soundSelect();
             else
                 soundInvalid();
 
-            apiCall("ready");
             clearCommonInput();
             return;
         }
 
-        // Wait on this player to attack
-        if (clientState.game.activePlayer == 0 && clientState.game.status >= STATUS_GAMESTART)
+        // Wait on this player to attack, unless their attack has not reached the server yet,
+        // or the last attacks are still playing
+        if (clientState.game.activePlayer == 0 && clientState.game.status >= STATUS_GAMESTART && !movePending() && !animationEnd())
         {
             waitOnPlayerMove();
         }
@@ -626,7 +830,7 @@ void waitOnPlayerMove()
             // Check if at least one enemy cell is valid to attack
             for (i = 1; i < clientState.game.playerCount; i++)
             {
-                if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && state.gamefield[i][attackPos] == 0 )
+                if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && clientState.game.players[i].gamefield[attackPos] == 0)
                     break;
             }
 
@@ -640,16 +844,19 @@ void waitOnPlayerMove()
                 // Attack!
                 soundAttack();
                 
-                // Animate attack / clear cursor
-                for (j = 10; j < 16; j++)
+                // Animate attack / clear cursor. The move is sent while the attack plays
+                j = 0;
+                for (i = 1; i < clientState.game.playerCount; i++)
                 {
-                    for (i = 1; i < clientState.game.playerCount; i++)
+                    if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
                     {
-                        if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT)
-                            drawGamefieldUpdate(i, clientState.game.players[i].gamefield, attackPos, state.gamefield[i][attackPos] == 0 ?  j : 0);
+                        if (clientState.game.players[i].gamefield[attackPos] == 0)
+                            j |= 1 << i;
+                        else
+                            drawGamefieldUpdate(i, clientState.game.players[i].gamefield, attackPos, 0);
                     }
-                    pause(5);
                 }
+                queueAnimation(ANIM_ATTACK, 0, 6, 5, j, attackPos, 0);
 
                 // Send command to score this value
                 strcpy(moveBuffer, "attack/");
@@ -4,8 +4,45 @@
 void processStateChange();
 void renderLobby();
 void renderGameboard();
+
+/*
+ * Animation timeline
+ * Effects are queued to start a number of frames from now, and the main loop calls
+ * handleAnimation() once per frame to draw the steps that are due, so polling and input
+ * carry on while they play. An effect draws count steps, rate frames apart. Effects that
+ * must follow each other start at animationEnd(), and others may overlap them.
+ * Anything that redraws the screen clears the timeline, and the in-game menu skips it
+ * to the last step of each effect.
+ */
+#define ANIM_MAX 16
+#define ANIM_BACKLOG 60 // Frames of attacks still to play, beyond which new ones play compressed
+
+#define ANIM_NONE 0
+#define ANIM_ATTACK 1   // Attack frames at pos b, on the boards in bit mask a
+#define ANIM_RESULT 2   // Hit/miss blink at pos b, on the boards in bit mask a, with the sound for status c
+#define ANIM_LEGEND 3   // Legend ship b of player a sinking, with the sink sound if c
+#define ANIM_BLINK 4    // Name of active player a blinking
+#define ANIM_PROGRESS 5 // Progress marks on row a
+#define ANIM_HOLD 6     // Draws nothing, but holds off the next effect and the player's turn
+
+/// @brief Draws the animation steps due this frame
 void handleAnimation();
 
+/// @brief Queues an effect to start in start frames
+void queueAnimation(uint8_t type, uint16_t start, uint8_t count, uint8_t rate, uint8_t a, uint8_t b, uint8_t c);
+
+/// @brief Returns the frames until every queued effect has played, 0 if none
+uint16_t animationEnd();
+
+/// @brief Draws the last step of every queued effect at once, without sound
+void skipAnimations();
+
+/// @brief Plays every queued effect to the end before returning
+void finishAnimations();
+
+/// @brief Drops every queued effect, for a screen about to be redrawn
+void clearAnimations();
+
 void processInput();
 
 void clearRenderState();
@@ -0,0 +1,79 @@
+/*
+  FujiNet appkeys for the headless Linux host build
+
+  Each appkey is a file in the FBS_APPKEYS directory (default "appkeys"),
+  named like the FujiNet firmware names them on its SD card. A missing lobby
+  server or username key is seeded from FBS_SERVER or FBS_PLAYER, the same
+  way the lobby would have left them.
+*/
+
+#include <sys/stat.h>
+#include "../misc.h"
+#include "../fujinet-fuji.h"
+
+static uint16_t appkeyCreator;
+static uint8_t appkeyApp;
+
+/// @brief Writes the path of the appkey file for key_id into path
+static void appkeyPath(char *path, uint8_t key_id)
+{
+    const char *dir = getenv("FBS_APPKEYS");
+
+    sprintf(path, "%s/%04hx%02hhx%02hhx.key", dir ? dir : "appkeys", appkeyCreator, appkeyApp, key_id);
+}
+
+void fuji_set_appkey_details(uint16_t creator_id, uint8_t app_id, enum AppKeySize keysize)
+{
+    (void)keysize;
+    appkeyCreator = creator_id;
+    appkeyApp = app_id;
+}
+
+bool fuji_read_appkey(uint8_t key_id, uint16_t *count, uint8_t *data)
+{
+    static char path[280];
+    const char *seed = NULL;
+    FILE *f;
+
+    appkeyPath(path, key_id);
+    if ((f = fopen(path, "rb")))
+    {
+        *count = (uint16_t)fread(data, 1, MAX_APPKEY_LEN, f);
+        fclose(f);
+        return true;
+    }
+
+    if (appkeyCreator == AK_LOBBY_CREATOR_ID && appkeyApp == AK_LOBBY_APP_ID)
+    {
+        if (key_id == AK_LOBBY_KEY_SERVER)
+            seed = getenv("FBS_SERVER");
+        else if (key_id == AK_LOBBY_KEY_USERNAME)
+            seed = getenv("FBS_PLAYER");
+    }
+
+    if (!seed)
+        return false;
+
+    *count = (uint16_t)strlen(seed);
+    if (*count > MAX_APPKEY_LEN)
+        *count = MAX_APPKEY_LEN;
+    memcpy(data, seed, *count);
+    return true;
+}
+
+bool fuji_write_appkey(uint8_t key_id, uint16_t count, uint8_t *data)
+{
+    static char path[280];
+    const char *dir = getenv("FBS_APPKEYS");
+    FILE *f;
+
+    mkdir(dir ? dir : "appkeys", 0755);
+
+    appkeyPath(path, key_id);
+    if (!(f = fopen(path, "wb")))
+        return false;
+
+    fwrite(data, 1, count > MAX_APPKEY_LEN ? MAX_APPKEY_LEN : count, f);
+    fclose(f);
+    return true;
+}
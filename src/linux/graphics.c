@@ -0,0 +1,418 @@
+/*
+  Graphics functionality for the headless Linux host build
+
+  Everything is drawn into an in-memory 40x25 tile buffer, using printable
+  characters as tiles. Set FBS_SHOW to print the buffer to stdout whenever it
+  changes, and FBS_FAST to run frames as fast as possible instead of at 60Hz.
+  Network timeouts are counted in frames, so even FBS_FAST keeps frames at
+  60Hz while a reply is on its way from the server.
+
+  With SHADOW_TILES (see vars.h), tiles are drawn to the shared shadow map and
+  copied to the buffer at each waitvsync, as on the 8-bit platforms.
+*/
+
+#include <time.h>
+#include "../misc.h"
+
+#ifdef SHADOW_TILES
+#define tiles shadowTiles
+#else
+#define tiles screen
+#endif
+
+#define xypos(x, y) (tiles + (x) + (y) * WIDTH)
+
+#define TILE_SEA '.'
+#define TILE_HIT 'X'
+#define TILE_HIT2 'x'
+#define TILE_MISS 'o'
+#define TILE_HIT_LEGEND '-'
+#define TILE_LINE_H '-'
+#define TILE_BORDER_H '='
+#define TILE_BORDER_V '|'
+#define TILE_CORNER '+'
+#define TILE_ACTIVE_INDICATOR '>'
+#define TILE_CLOCK '@'
+#define TILE_CONNECTION '!'
+#define TILE_CURSOR '#'
+
+#define TILE_SHIP_LEFT '<'
+#define TILE_SHIP_HULL_H '='
+#define TILE_SHIP_RIGHT '>'
+#define TILE_SHIP_TOP '^'
+#define TILE_SHIP_HULL_V '|'
+#define TILE_SHIP_BOTTOM 'v'
+
+// Attack animation frames 10-15
+static const char attackTiles[] = ".:+*#@";
+
+uint8_t screen[WIDTH * HEIGHT];
+static uint8_t shown[WIDTH * HEIGHT];
+static uint8_t screenBak[WIDTH * HEIGHT];
+
+// Frames since start, advanced by waitvsync
+uint16_t jiffies;
+
+// In network.c
+void networkWait(int ms);
+
+static bool showScreen, fastFrames;
+static struct timespec nextFrame;
+
+static uint8_t fieldX = 0, playerCount = 0;
+
+// Cursor is an overlay, like the sprite cursors on other platforms
+static int16_t cursorPos = -1;
+
+static uint16_t quadrant_offset[] = {
+    WIDTH * 14 + 8,
+    WIDTH * 2 + 8,
+    WIDTH * 2 + 21,
+    WIDTH * 14 + 21};
+
+static uint8_t legendShipOffset[] = {2, 1, 0, WIDTH * 5, WIDTH * 6 + 1};
+
+uint8_t cycleNextColor()
+{
+    return 0;
+}
+
+void initGraphics()
+{
+    showScreen = getenv("FBS_SHOW") != NULL;
+    fastFrames = getenv("FBS_FAST") != NULL;
+    clock_gettime(CLOCK_MONOTONIC, &nextFrame);
+    memset(tiles, ' ', sizeof(screen));
+    shadowTouch(0, HEIGHT);
+}
+
+void resetGraphics()
+{
+    memset(tiles, ' ', sizeof(screen));
+    shadowTouch(0, HEIGHT);
+}
+
+bool saveScreenBuffer()
+{
+    memcpy(screenBak, tiles, sizeof(screenBak));
+    return true;
+}
+
+void restoreScreenBuffer()
+{
+    waitvsync();
+    memcpy(tiles, screenBak, sizeof(screenBak));
+    shadowTouch(0, HEIGHT);
+}
+
+/// @brief Prints the tile buffer to stdout, with the cursor overlay
+static void printScreen()
+{
+    static uint8_t y;
+
+    memcpy(shown, screen, sizeof(shown));
+    if (cursorPos >= 0)
+        shown[cursorPos] = TILE_CURSOR;
+
+    // Home the cursor, then draw the buffer in place
+    fputs("\033[H", stdout);
+    for (y = 0; y < HEIGHT; y++)
+    {
+        fwrite(shown + y * WIDTH, 1, WIDTH, stdout);
+        fputc('\n', stdout);
+    }
+    fflush(stdout);
+}
+
+void waitvsync()
+{
+    jiffies++;
+
+#ifdef SHADOW_TILES
+    shadowFlush(screen);
+#endif
+
+    if (showScreen && (memcmp(shown, screen, sizeof(shown)) || (cursorPos >= 0 && shown[cursorPos] != TILE_CURSOR)))
+        printScreen();
+
+    if (fastFrames)
+    {
+        // A reply ends the frame early, so round trips are not rounded up to whole frames
+        networkWait(1000 / 60);
+        return;
+    }
+
+    // Pace to 60 frames per second
+    nextFrame.tv_nsec += 1000000000L / 60;
+    if (nextFrame.tv_nsec >= 1000000000L)
+    {
+        nextFrame.tv_nsec -= 1000000000L;
+        nextFrame.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextFrame, NULL);
+}
+
+static void drawTextAt(uint8_t *pos, const char *s)
+{
+    char c;
+
+    shadowTouchAt(pos, 1);
+    while ((c = *s++))
+    {
+        // Lowercase, as the 8-bit charsets mostly lack lowercase letters
+        if (c >= 'A' && c <= 'Z')
+            c += 32;
+        *pos++ = c;
+    }
+}
+
+void drawText(uint8_t x, uint8_t y, const char *s)
+{
+    drawTextAt(xypos(x, y), s);
+}
+
+void drawTextAlt(uint8_t x, uint8_t y, const char *s)
+{
+    // Alternate color is shown as uppercase
+    memcpy(xypos(x, y), s, strlen(s));
+    shadowTouch(y, 1);
+}
+
+void resetScreen()
+{
+    memset(tiles, ' ', sizeof(screen));
+    shadowTouch(0, HEIGHT);
+    cursorPos = -1;
+}
+
+void drawIcon(uint8_t x, uint8_t y, uint8_t icon)
+{
+    *xypos(x, y) = icon;
+    shadowTouch(y, 1);
+}
+
+void drawBlank(uint8_t x, uint8_t y)
+{
+    *xypos(x, y) = ' ';
+    shadowTouch(y, 1);
+}
+
+void drawSpace(uint8_t x, uint8_t y, uint8_t w)
+{
+    memset(xypos(x, y), ' ', w);
+    shadowTouch(y, 1);
+}
+
+void drawClock()
+{
+    *xypos(WIDTH - 1, HEIGHT - 1) = TILE_CLOCK;
+    shadowTouch(HEIGHT - 1, 1);
+}
+
+void drawConnectionIcon(bool show)
+{
+    *xypos(0, HEIGHT - 1) = show ? TILE_CONNECTION : ' ';
+    shadowTouch(HEIGHT - 1, 1);
+}
+
+void drawPlayerName(uint8_t player, const char *name, bool active)
+{
+    static uint8_t i;
+    uint8_t *dest = tiles + fieldX + quadrant_offset[player] - WIDTH - 1;
+
+    // From the border above the board to the one below it
+    shadowTouchAt(dest, 12);
+
+    // Name label below the bottom boards and above the top boards
+    if (player == 0 || player == 3)
+    {
+        memset(dest, TILE_BORDER_H, 12);
+        dest += WIDTH * 11;
+    }
+    else
+    {
+        memset(dest + WIDTH * 11, TILE_BORDER_H, 12);
+    }
+
+    memset(dest, ' ', 12);
+    dest[1] = active ? TILE_ACTIVE_INDICATOR : ' ';
+    drawTextAt(dest + 2, name);
+
+    // Side borders
+    dest = tiles + fieldX + quadrant_offset[player] - 1;
+    for (i = 0; i < 10; i++)
+    {
+        dest[0] = dest[11] = TILE_BORDER_V;
+        dest += WIDTH;
+    }
+}
+
+void drawBoard(uint8_t currentPlayerCount)
+{
+    static uint8_t i, y;
+    static uint8_t *dest;
+    playerCount = currentPlayerCount;
+    fieldX = playerCount > 2 ? 0 : 7;
+
+    for (i = 0; i < playerCount; i++)
+    {
+        dest = tiles + fieldX + quadrant_offset[i];
+
+        drawPlayerName(i, "", false);
+
+        for (y = 0; y < 10; y++)
+        {
+            memset(dest + y * WIDTH, TILE_SEA, 10);
+        }
+
+        // drawPlayerName() spans these rows only in passing
+        shadowTouchAt(dest, 10);
+    }
+}
+
+void drawLine(uint8_t x, uint8_t y, uint8_t w)
+{
+    memset(xypos(x, y), TILE_LINE_H, w);
+    shadowTouch(y, 1);
+}
+
+static void drawShipInternal(uint8_t *dest, uint8_t size, uint8_t delta)
+{
+    static uint8_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (delta)
+        {
+            *dest = i == 0 ? TILE_SHIP_TOP : i == size - 1 ? TILE_SHIP_BOTTOM : TILE_SHIP_HULL_V;
+            dest += WIDTH;
+        }
+        else
+        {
+            *dest++ = i == 0 ? TILE_SHIP_LEFT : i == size - 1 ? TILE_SHIP_RIGHT : TILE_SHIP_HULL_H;
+        }
+    }
+}
+
+void drawShip(uint8_t quadrant, uint8_t size, uint8_t pos, bool hide)
+{
+    uint8_t i, delta = 0;
+    uint8_t *dest;
+
+    if (pos > 99)
+    {
+        delta = 1; // 1=vertical, 0=horizontal
+        pos -= 100;
+    }
+
+    dest = xypos((pos % 10), (pos / 10)) + fieldX + quadrant_offset[quadrant];
+    shadowTouchAt(dest, delta ? size : 1);
+
+    if (hide)
+    {
+        for (i = 0; i < size; i++)
+            dest[delta ? i * WIDTH : i] = TILE_SEA;
+        return;
+    }
+
+    drawShipInternal(dest, size, delta);
+}
+
+void drawLegendShip(uint8_t player, uint8_t index, uint8_t size, uint8_t status)
+{
+    static uint8_t i;
+    uint8_t *dest = tiles + fieldX + quadrant_offset[player] + legendShipOffset[index];
+
+    // Drawers are to the right of the right hand boards, and left of the others
+    if (player > 1 || (player > 0 && fieldX > 0))
+        dest += WIDTH + 11;
+    else
+        dest += WIDTH - 4;
+    shadowTouchAt(dest, size);
+
+    if (status)
+    {
+        drawShipInternal(dest, size, 1);
+    }
+    else
+    {
+        for (i = 0; i < size; i++)
+            dest[i * WIDTH] = TILE_HIT_LEGEND;
+    }
+}
+
+void drawGamefield(uint8_t quadrant, uint8_t *field)
+{
+    static uint8_t y, x;
+    uint8_t *dest = tiles + quadrant_offset[quadrant] + fieldX;
+
+    shadowTouchAt(dest, 10);
+    for (y = 0; y < 10; ++y)
+    {
+        for (x = 0; x < 10; ++x)
+        {
+            if (*field)
+            {
+                *dest = *field == FIELD_ATTACK ? TILE_HIT : TILE_MISS;
+            }
+            field++;
+            dest++;
+        }
+
+        dest += WIDTH - 10;
+    }
+}
+
+void drawGamefieldUpdate(uint8_t quadrant, uint8_t *gamefield, uint8_t attackPos, uint8_t anim)
+{
+    uint8_t *dest = tiles + quadrant_offset[quadrant] + fieldX + (uint16_t)(attackPos / 10) * WIDTH + (attackPos % 10);
+    uint8_t c = gamefield[attackPos];
+
+    shadowTouchAt(dest, 1);
+    cursorPos = -1;
+
+    // Animate attack
+    if (anim > 9)
+    {
+        *dest = attackTiles[anim - 10];
+        return;
+    }
+
+    if (c == FIELD_ATTACK)
+    {
+        *dest = anim ? TILE_HIT2 : TILE_HIT;
+    }
+    else if (c == FIELD_MISS)
+    {
+        *dest = TILE_MISS;
+    }
+}
+
+void drawGamefieldCursor(uint8_t quadrant, uint8_t x, uint8_t y, uint8_t *gamefield, uint8_t blink)
+{
+    cursorPos = quadrant_offset[quadrant] + y * WIDTH + fieldX + x;
+
+    (void)gamefield;
+    (void)blink;
+}
+
+void drawEndgameMessage(const char *message)
+{
+    uint8_t i, x;
+    i = (uint8_t)strlen(message);
+    x = WIDTH / 2 - i / 2;
+
+    memset(xypos(0, HEIGHT - 2), TILE_LINE_H, WIDTH);
+    memset(xypos(0, HEIGHT - 1), ' ', WIDTH);
+    shadowTouch(HEIGHT - 2, 2);
+    drawText(x, HEIGHT - 1, message);
+}
+
+void drawBox(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+    uint8_t *pos = xypos(x, y);
+
+    pos[0] = pos[w + 1] = TILE_CORNER;
+    pos[(h + 1) * WIDTH] = pos[(h + 1) * WIDTH + w + 1] = TILE_CORNER;
+    shadowTouch(y, h + 2);
+}
@@ -0,0 +1,146 @@
+/*
+  Platform specific input for the headless Linux host build
+
+  Keys are read from stdin, switched to raw mode when it is a terminal.
+  There is no joystick, unless FBS_AUTOPLAY is set, in which case the
+  joystick plays the game: it readies up in the lobby, accepts the ship
+  placement and wanders the cursor a little before each attack.
+*/
+
+#include <poll.h>
+#include <termios.h>
+// unistd.h declares a pause() that clashes with the one in sound.h
+#define pause posix_pause
+#include <unistd.h>
+#undef pause
+#include "../misc.h"
+
+static bool inputReady, autoplay, stdinClosed, rawMode;
+static struct termios savedTermios;
+static uint8_t autoFrames;
+
+static void restoreTerminal()
+{
+    if (rawMode)
+        tcsetattr(STDIN_FILENO, TCSANOW, &savedTermios);
+}
+
+static void initInput()
+{
+    struct termios raw;
+
+    inputReady = true;
+    autoplay = getenv("FBS_AUTOPLAY") != NULL;
+
+    if (isatty(STDIN_FILENO) && !tcgetattr(STDIN_FILENO, &savedTermios))
+    {
+        raw = savedTermios;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        rawMode = !tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        atexit(restoreTerminal);
+    }
+}
+
+/// @brief Returns true if a byte can be read from stdin within ms milliseconds
+static bool stdinWaiting(int ms)
+{
+    struct pollfd pfd;
+
+    if (stdinClosed)
+        return false;
+
+    pfd.fd = STDIN_FILENO;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, ms) > 0;
+}
+
+/// @brief Reads a byte from stdin, or returns -1 once it is closed
+static int readByte()
+{
+    unsigned char c;
+
+    if (stdinClosed || read(STDIN_FILENO, &c, 1) != 1)
+    {
+        stdinClosed = true;
+        return -1;
+    }
+    return c;
+}
+
+uint8_t readJoystick()
+{
+    if (!inputReady)
+        initInput();
+
+    if (!autoplay)
+        return 0;
+
+    // Release between presses, so each press registers
+    if (++autoFrames < 8)
+        return 0;
+    autoFrames = 0;
+
+    if (state.inGame && !state.waitingOnEndGameContinue)
+    {
+        // Stay ready once ready in the lobby
+        if (clientState.game.status == STATUS_LOBBY &&
+            (state.readyPending ? state.readyWanted : clientState.lobby.playerStatus == PLAYER_STATUS_READY))
+            return 0;
+
+        // Wander before attacking
+        if (clientState.game.status >= STATUS_GAMESTART && getRandomNumber(3))
+            return 1 << getRandomNumber(4);
+    }
+
+    return 16;
+}
+
+int kbhit(void)
+{
+    if (!inputReady)
+        initInput();
+
+    return stdinWaiting(0);
+}
+
+int cgetc(void)
+{
+    int c;
+
+    if (!inputReady)
+        initInput();
+
+    // Unattended runs carry on past any "press a key" prompts
+    if (autoplay && !stdinWaiting(0))
+        return KEY_RETURN;
+
+    if ((c = readByte()) < 0)
+        return KEY_RETURN;
+
+    // Arrow keys arrive as ESC [ A..D
+    if (c == KEY_ESCAPE && stdinWaiting(5))
+    {
+        if ((c = readByte()) != '[' || !stdinWaiting(5))
+            return KEY_ESCAPE;
+
+        switch (readByte())
+        {
+        case 'A':
+            return KEY_UP_ARROW;
+        case 'B':
+            return KEY_DOWN_ARROW;
+        case 'C':
+            return KEY_RIGHT_ARROW;
+        case 'D':
+            return KEY_LEFT_ARROW;
+        }
+        return KEY_ESCAPE;
+    }
+
+    if (c == 13)
+        return KEY_RETURN;
+
+    return c;
+}
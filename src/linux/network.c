@@ -0,0 +1,373 @@
+/*
+  FujiNet network calls for the headless Linux host build, backed by sockets
+
+  Only what the client uses is implemented:
+    n:http://host[:port]/path  HTTP GET. The whole response is read when the
+                               channel is opened, as FujiNet does for small bodies
+    n:tcp://host:port/         Raw TCP, for the keep-alive session
+  https is not supported, so point FBS_SERVER at a plain http server.
+*/
+
+#define _GNU_SOURCE // memmem
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+// unistd.h declares a pause() that clashes with the one in sound.h
+#define pause posix_pause
+#include <unistd.h>
+#undef pause
+#include "../misc.h"
+#include "../fujinet-network.h"
+
+#define CHANNEL_MAX 4
+#define SPEC_MAX 160
+
+// Reply progress on a tcp channel, so FBS_FAST can wait out network round trips.
+// Once part of a reply is read, the channel counts down quiet frames before the reply is
+// taken as done, as the rest may trail behind (e.g. a body sent after its header)
+#define AWAIT_NONE 0
+#define AWAIT_QUIET_FRAMES 6
+#define AWAIT_REPLY 0xFF // Written to, and nothing read back yet
+
+typedef struct
+{
+    char spec[SPEC_MAX];
+    int fd;            // Socket for tcp, -1 for http
+    uint8_t *body;     // Response body for http
+    uint16_t bodyLen, bodyPos;
+    uint8_t awaiting;  // AWAIT_NONE, AWAIT_REPLY, or quiet frames left
+} Channel;
+
+static Channel channels[CHANNEL_MAX];
+
+uint16_t fn_bytes_read;
+uint8_t fn_network_error;
+uint16_t fn_network_bw;
+uint8_t fn_network_conn;
+
+static Channel *findChannel(const char *devicespec)
+{
+    static uint8_t i;
+
+    for (i = 0; i < CHANNEL_MAX; i++)
+    {
+        if (channels[i].spec[0] && !strcmp(channels[i].spec, devicespec))
+            return &channels[i];
+    }
+    return NULL;
+}
+
+/// @brief Connects to "host[:port]..." at s, stopping at the first '/'. Returns the socket or -1
+static int connectTo(const char *s, const char *defaultPort)
+{
+    struct addrinfo hints, *res, *ai;
+    char host[64], port[8];
+    uint8_t i = 0, j = 0;
+    int fd = -1, one = 1;
+
+    while (*s && *s != '/' && *s != ':' && i < sizeof(host) - 1)
+        host[i++] = *s++;
+    host[i] = 0;
+
+    if (*s == ':')
+    {
+        s++;
+        while (*s >= '0' && *s <= '9' && j < sizeof(port) - 1)
+            port[j++] = *s++;
+    }
+    port[j] = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, j ? port : defaultPort, &hints, &res))
+        return -1;
+
+    for (ai = res; ai; ai = ai->ai_next)
+    {
+        if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0)
+            continue;
+        if (!connect(fd, ai->ai_addr, ai->ai_addrlen))
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd >= 0)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static bool sendAll(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    ssize_t n;
+
+    while (len)
+    {
+        if ((n = send(fd, p, len, MSG_NOSIGNAL)) <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/// @brief Performs an HTTP/1.0 GET of url ("http://..."), keeping the body in the channel
+static uint8_t httpGet(Channel *ch, const char *url)
+{
+    static char request[SPEC_MAX + 96];
+    const char *host = url + 7, *path;
+    uint8_t *resp = NULL, *p;
+    size_t len = 0, size = 0;
+    ssize_t n;
+    int fd;
+
+    path = strchr(host, '/');
+    if ((fd = connectTo(host, "80")) < 0)
+        return FN_ERR_IO_ERROR;
+
+    snprintf(request, sizeof(request), "GET %s HTTP/1.0\r\nHost: %.*s\r\nConnection: close\r\n\r\n",
+             path ? path : "/", path ? (int)(path - host) : (int)strlen(host), host);
+
+    if (!sendAll(fd, request, strlen(request)))
+    {
+        close(fd);
+        return FN_ERR_IO_ERROR;
+    }
+
+    // Read until the server closes the connection
+    do
+    {
+        if (len == size)
+        {
+            size = size ? size * 2 : 4096;
+            resp = realloc(resp, size);
+        }
+        n = recv(fd, resp + len, size - len, 0);
+        if (n > 0)
+            len += n;
+    } while (n > 0 || (n < 0 && errno == EINTR));
+    close(fd);
+
+    // "HTTP/1.x 2xx", then the body after the blank line
+    p = len > 12 ? memmem(resp, len, "\r\n\r\n", 4) : NULL;
+    if (!p || resp[9] != '2' || len > 0xFFFF)
+    {
+        free(resp);
+        return FN_ERR_IO_ERROR;
+    }
+
+    ch->body = resp;
+    ch->bodyPos = p + 4 - resp;
+    ch->bodyLen = len;
+    return FN_ERR_OK;
+}
+
+/// @brief Waits up to ms milliseconds for more data on any channel awaiting a reply.
+/// The client leaves a partial reply unread until the rest arrives, so this watches the
+/// count of waiting bytes rather than readability
+void networkWait(int ms)
+{
+    static int waiting[CHANNEL_MAX];
+    static uint8_t i;
+    static bool any;
+    int n;
+
+    for (i = 0, any = false; i < CHANNEL_MAX; i++)
+    {
+        waiting[i] = -1;
+        if (channels[i].spec[0] && channels[i].fd >= 0 && channels[i].awaiting)
+        {
+            ioctl(channels[i].fd, FIONREAD, &waiting[i]);
+            any = true;
+        }
+    }
+
+    if (!any)
+        return;
+
+    while (ms-- > 0)
+    {
+        usleep(1000);
+        for (i = 0; i < CHANNEL_MAX; i++)
+        {
+            if (waiting[i] >= 0 && (ioctl(channels[i].fd, FIONREAD, &n) || n != waiting[i]))
+                return;
+        }
+    }
+
+    for (i = 0; i < CHANNEL_MAX; i++)
+    {
+        if (channels[i].awaiting && channels[i].awaiting != AWAIT_REPLY)
+            channels[i].awaiting--;
+    }
+}
+
+uint8_t network_init()
+{
+    return FN_ERR_OK;
+}
+
+uint8_t network_open(char *devicespec, uint8_t mode, uint8_t trans)
+{
+    static uint8_t i;
+    Channel *ch;
+    const char *url = devicespec;
+
+    (void)mode;
+    (void)trans;
+
+    if ((url[0] | 0x20) == 'n' && url[1] == ':')
+        url += 2;
+
+    if (findChannel(devicespec))
+        network_close(devicespec);
+
+    for (i = 0; i < CHANNEL_MAX && channels[i].spec[0]; i++)
+        ;
+    if (i == CHANNEL_MAX || strlen(devicespec) >= SPEC_MAX)
+        return FN_ERR_BAD_CMD;
+
+    ch = &channels[i];
+    ch->fd = -1;
+    ch->body = NULL;
+    ch->bodyLen = ch->bodyPos = 0;
+
+    if (!strncmp(url, "http://", 7))
+    {
+        if (httpGet(ch, url))
+            return FN_ERR_IO_ERROR;
+    }
+    else if (!strncmp(url, "tcp://", 6))
+    {
+        if ((ch->fd = connectTo(url + 6, "80")) < 0)
+            return FN_ERR_IO_ERROR;
+    }
+    else
+    {
+        return FN_ERR_BAD_CMD;
+    }
+
+    strcpy(ch->spec, devicespec);
+    return FN_ERR_OK;
+}
+
+uint8_t network_close(char *devicespec)
+{
+    Channel *ch = findChannel(devicespec);
+
+    if (!ch)
+        return FN_ERR_BAD_CMD;
+
+    if (ch->fd >= 0)
+        close(ch->fd);
+    free(ch->body);
+    memset(ch, 0, sizeof(Channel));
+    return FN_ERR_OK;
+}
+
+uint8_t network_status(char *devicespec, uint16_t *bw, uint8_t *c, uint8_t *err)
+{
+    Channel *ch = findChannel(devicespec);
+    int waiting = 0;
+    ssize_t n;
+    uint8_t probe;
+
+    if (!ch)
+        return FN_ERR_BAD_CMD;
+
+    *err = 0;
+    if (ch->fd < 0)
+    {
+        // The http body is all here, so the connection is already done
+        *bw = ch->bodyLen - ch->bodyPos;
+        *c = 0;
+    }
+    else
+    {
+        ioctl(ch->fd, FIONREAD, &waiting);
+        *bw = waiting > 0xFFFF ? 0xFFFF : (uint16_t)waiting;
+
+        // A zero length peek means the server closed the connection
+        n = recv(ch->fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+        *c = n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+
+    fn_network_bw = *bw;
+    fn_network_conn = *c;
+    fn_network_error = *err;
+    return FN_ERR_OK;
+}
+
+static int16_t readChannel(char *devicespec, uint8_t *buf, uint16_t len, bool block)
+{
+    Channel *ch = findChannel(devicespec);
+    uint16_t got = 0;
+    ssize_t n;
+
+    fn_bytes_read = 0;
+    if (!ch)
+        return -FN_ERR_BAD_CMD;
+
+    if (ch->fd < 0)
+    {
+        got = ch->bodyLen - ch->bodyPos;
+        if (got > len)
+            got = len;
+        memcpy(buf, ch->body + ch->bodyPos, got);
+        ch->bodyPos += got;
+    }
+    else
+    {
+        while (got < len)
+        {
+            n = recv(ch->fd, buf + got, len - got, block ? 0 : MSG_DONTWAIT);
+            if (n > 0)
+                got += n;
+            else if (n < 0 && errno == EINTR)
+                continue;
+            else if (n < 0 && !block && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            else
+            {
+                fn_network_error = n ? (uint8_t)errno : 0;
+                if (!got)
+                    return -FN_ERR_IO_ERROR;
+                break;
+            }
+        }
+    }
+
+    if (got && ch->awaiting)
+        ch->awaiting = AWAIT_QUIET_FRAMES;
+
+    fn_bytes_read = got;
+    return got;
+}
+
+int16_t network_read_nb(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    return readChannel(devicespec, buf, len, false);
+}
+
+int16_t network_read(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    return readChannel(devicespec, buf, len, true);
+}
+
+uint8_t network_write(char *devicespec, uint8_t *buf, uint16_t len)
+{
+    Channel *ch = findChannel(devicespec);
+
+    if (!ch || ch->fd < 0)
+        return FN_ERR_BAD_CMD;
+
+    ch->awaiting = AWAIT_REPLY;
+    return sendAll(ch->fd, buf, len) ? FN_ERR_OK : FN_ERR_IO_ERROR;
+}
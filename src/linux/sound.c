@@ -0,0 +1,70 @@
+/*
+  Platform specific sound functions for the headless Linux host build.
+  There is no audio, so every sound is a no-op.
+*/
+
+#include "../misc.h"
+
+void initSound()
+{
+}
+
+void disableKeySounds()
+{
+}
+
+void enableKeySounds()
+{
+}
+
+void soundCursor()
+{
+}
+
+void soundSelect()
+{
+}
+
+void soundStop()
+{
+}
+
+void soundJoinGame()
+{
+}
+
+void soundMyTurn()
+{
+}
+
+void soundGameDone()
+{
+}
+
+void soundTick()
+{
+}
+
+void soundPlaceShip()
+{
+}
+
+void soundAttack()
+{
+}
+
+void soundInvalid()
+{
+}
+
+void soundHit()
+{
+}
+
+void soundSink()
+{
+}
+
+void soundMiss()
+{
+}
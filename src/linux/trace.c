@@ -0,0 +1,201 @@
+/*
+  Api trace capture and replay for the headless Linux host build
+
+    FBS_CAPTURE=file       Append every response the client receives to file
+    FBS_REPLAY=file        Answer the client's calls from file instead of the server,
+                           in recorded order, then exit with a summary on stderr
+    FBS_REPLAY_SPEED=n     Replay n times faster than recorded (default 1).
+                           0 answers every call at once
+
+  A replayed response is held until its recorded time, so a replay is never
+  faster than the trace, but the client's 60Hz frames still pace it unless
+  FBS_FAST is set. Together, FBS_FAST and FBS_REPLAY_SPEED=0 run the same game
+  through processStateChange() and the renderer as fast as the build allows,
+  and the summary's elapsed time compares builds on identical input. Replay
+  with the FBS_SERVER, FBS_PLAYER, FBS_AUTOPLAY and FBS_SEED used to capture,
+  so the client reaches the same screens and sends the same calls.
+
+  The trace is a "FBT1" tag followed by one record per response:
+    [ms since the first response, 4 bytes][url length][url][body length, 2 bytes][body]
+  Numbers are little endian. The url is stored without the "n:" prefix and
+  server endpoint, and the body starts with the response's first byte.
+*/
+
+#include <time.h>
+#include "../misc.h"
+
+#define TRACE_TAG "FBT1"
+
+// Frames since start, advanced by waitvsync
+extern uint16_t jiffies;
+
+static bool traceReady;
+static FILE *captureFile, *replayFile;
+static uint32_t speed = 1;
+static struct timespec traceStart;
+static bool started;
+
+// Response being replayed
+static uint8_t body[sizeof(ClientState) + 1];
+static uint16_t bodyLen, bodyPos;
+static uint32_t bodyDue, replayed;
+
+static uint64_t elapsedMicros()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!started)
+    {
+        traceStart = now;
+        started = true;
+    }
+    return (uint64_t)(now.tv_sec - traceStart.tv_sec) * 1000000 + (now.tv_nsec - traceStart.tv_nsec) / 1000;
+}
+
+static uint32_t elapsedMs()
+{
+    return (uint32_t)(elapsedMicros() / 1000);
+}
+
+static void writeNumber(uint32_t n, uint8_t bytes)
+{
+    while (bytes--)
+    {
+        fputc(n & 0xFF, captureFile);
+        n >>= 8;
+    }
+}
+
+/// @brief Reads a little endian number, returning false at the end of the trace
+static bool readNumber(uint32_t *n, uint8_t bytes)
+{
+    static uint8_t i;
+    int c;
+
+    *n = 0;
+    for (i = 0; i < bytes; i++)
+    {
+        if ((c = fgetc(replayFile)) == EOF)
+            return false;
+        *n |= (uint32_t)c << (i * 8);
+    }
+    return true;
+}
+
+static void initTrace()
+{
+    const char *name;
+    char tag[4];
+
+    traceReady = true;
+
+    if ((name = getenv("FBS_REPLAY")))
+    {
+        if (!(replayFile = fopen(name, "rb")) || fread(tag, 1, 4, replayFile) != 4 || memcmp(tag, TRACE_TAG, 4))
+        {
+            fprintf(stderr, "%s is not a trace\n", name);
+            exit(1);
+        }
+        if (getenv("FBS_REPLAY_SPEED"))
+            speed = (uint32_t)atoi(getenv("FBS_REPLAY_SPEED"));
+    }
+
+    if ((name = getenv("FBS_CAPTURE")))
+    {
+        if (!(captureFile = fopen(name, "ab")))
+        {
+            perror(name);
+            exit(1);
+        }
+        if (!ftell(captureFile))
+            fputs(TRACE_TAG, captureFile);
+    }
+}
+
+/// @brief Returns url without the "n:" prefix and server endpoint
+static const char *tracePath(const char *url)
+{
+    static uint8_t len;
+
+    len = (uint8_t)strlen(serverEndpoint);
+    return strncmp(url + 2, serverEndpoint, len) ? url : url + 2 + len;
+}
+
+void traceCapture(const char *url, uint8_t head, const uint8_t *data, uint16_t len)
+{
+    if (!traceReady)
+        initTrace();
+
+    if (!captureFile)
+        return;
+
+    url = tracePath(url);
+    writeNumber(elapsedMs(), 4);
+    writeNumber((uint8_t)strlen(url), 1);
+    fputs(url, captureFile);
+    writeNumber(len + 1, 2);
+    fputc(head, captureFile);
+    fwrite(data, 1, len, captureFile);
+    fflush(captureFile);
+}
+
+bool traceOpen(const char *url)
+{
+    static uint32_t due, len;
+    static char recordedUrl[256];
+
+    if (!traceReady)
+        initTrace();
+
+    if (!replayFile)
+        return false;
+
+    (void)url;
+
+    // The url is kept for reference only, as calls are answered in recorded order
+    if (!readNumber(&due, 4) || !readNumber(&len, 1) || fread(recordedUrl, 1, len, replayFile) != len ||
+        !readNumber(&len, 2) || len > sizeof(body) || fread(body, 1, len, replayFile) != len)
+    {
+        fprintf(stderr, "Replayed %u responses in %.3f ms, %u frames\n", replayed, elapsedMicros() / 1000.0, jiffies);
+        exit(0);
+    }
+
+    elapsedMs();
+    bodyDue = speed ? due / speed : 0;
+    bodyLen = (uint16_t)len;
+    bodyPos = 0;
+    replayed++;
+    return true;
+}
+
+int16_t traceAvailable(uint16_t len)
+{
+    static uint32_t now;
+    struct timespec wait;
+
+    // Wait out up to a frame, like a reply on its way from the server
+    if (bodyDue > (now = elapsedMs()))
+    {
+        wait.tv_sec = 0;
+        wait.tv_nsec = (bodyDue - now < 1000 / 60 ? bodyDue - now : 1000 / 60) * 1000000L;
+        nanosleep(&wait, NULL);
+        if (bodyDue > elapsedMs())
+            return 0;
+    }
+
+    if (bodyPos == bodyLen)
+        return -1;
+
+    return bodyLen - bodyPos < len ? bodyLen - bodyPos : len;
+}
+
+int16_t traceRead(uint8_t *buf, uint16_t len)
+{
+    if (len > bodyLen - bodyPos)
+        len = bodyLen - bodyPos;
+
+    memcpy(buf, body + bodyPos, len);
+    bodyPos += len;
+    return len;
+}
@@ -0,0 +1,104 @@
+/*
+  Platform specific utilities for the headless Linux host build
+
+  The build is driven by environment variables:
+    FBS_SHOW      Print the screen to stdout whenever it changes
+    FBS_FAST      Run frames as fast as possible instead of pacing them at 60Hz,
+                  except while waiting on the server. Animations and poll
+                  intervals are counted in frames, so they shrink to nothing
+    FBS_AUTOPLAY  Play unattended: ready up, place ships and attack at random
+    FBS_SERVER    Server url and table to join, e.g. http://127.0.0.1:8080/?table=bot1
+    FBS_PLAYER    Player name
+    FBS_APPKEYS   Directory holding appkey files (default "appkeys")
+    FBS_SEED      Random seed, for repeatable runs
+    FBS_CAPTURE, FBS_REPLAY, FBS_REPLAY_SPEED
+                  Record the server's responses to a trace file, or play one
+                  back instead of calling the server. See trace.c
+
+  FBS_SERVER and FBS_PLAYER only seed the appkeys, so they are ignored once an
+  appkey file exists.
+*/
+
+#include "../misc.h"
+
+// Frames since start, advanced by waitvsync in graphics.c
+extern uint16_t jiffies;
+
+static uint16_t timerStart;
+static bool seeded;
+
+void resetTimer()
+{
+    timerStart = jiffies;
+}
+
+uint16_t getTime()
+{
+    return jiffies - timerStart;
+}
+
+void quit()
+{
+    resetScreen();
+    resetGraphics();
+    exit(0);
+}
+
+void housekeeping()
+{
+}
+
+uint8_t getJiffiesPerSecond()
+{
+    return 60;
+}
+
+uint8_t getRandomNumber(uint8_t maxExclusive)
+{
+    if (!seeded)
+    {
+        srand(getenv("FBS_SEED") ? (unsigned)atoi(getenv("FBS_SEED")) : 1);
+        seeded = true;
+    }
+
+    if (maxExclusive == 0)
+        return 0;
+
+    return (uint8_t)(rand() % maxExclusive);
+}
+
+char *itoa(int value, char *s, int radix)
+{
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    char *p = s, *q;
+    unsigned int v;
+    char c;
+
+    if (value < 0 && radix == 10)
+    {
+        *p++ = '-';
+        v = (unsigned int)-value;
+    }
+    else
+    {
+        v = (unsigned int)value;
+    }
+
+    q = p;
+    do
+    {
+        *p++ = digits[v % radix];
+        v /= radix;
+    } while (v);
+    *p-- = 0;
+
+    // Digits were written least significant first
+    while (q < p)
+    {
+        c = *q;
+        *q++ = *p;
+        *p-- = c;
+    }
+
+    return s;
+}
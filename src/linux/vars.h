@@ -0,0 +1,73 @@
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+/*
+  Headless Linux host build, for profiling and benchmarking the client at native speed.
+  See util.c for the environment variables that drive it.
+*/
+
+/* Macros that evaluate the return code of readJoystick */
+#define JOY_UP(v) ((v) & 1)
+#define JOY_DOWN(v) ((v) & 2)
+#define JOY_LEFT(v) ((v) & 4)
+#define JOY_RIGHT(v) ((v) & 8)
+#define JOY_BTN_1(v) ((v) & 16)
+#define JOY_BTN_2(v) ((v) & 0)
+
+// Screen dimensions for platform
+
+#define WIDTH 40
+#define HEIGHT 25
+
+// Api trace capture and replay, see trace.c
+#define API_TRACE
+
+// Draw to the shadow tile map and copy it to the screen buffer in waitvsync, see shadow.h
+#define SHADOW_TILES
+
+// Replay the last delta onto the back state buffer rather than copying it, see stateclient.h
+#define STATE_DELTA_REPLAY
+
+// Count the calls to graphics.h and sound.h, see drawstats.h
+// #define DRAW_STATS
+
+// Other platform specific constants
+
+#define GAMEOVER_PROMPT_Y HEIGHT - 2
+
+// Icons
+#define ICON_TEXT_CURSOR '_'
+#define ICON_PLAYER '*'
+#define ICON_MARK '>'
+#define ICON_MARK_ALT ' '
+
+/**
+ * Platform specific key map for common input
+ */
+
+// Arrow keys arrive as escape sequences, and are mapped above the 8 bit range
+#define KEY_LEFT_ARROW 0x104
+#define KEY_LEFT_ARROW_2 43 // +
+#define KEY_LEFT_ARROW_3 60 // <
+
+#define KEY_RIGHT_ARROW 0x105
+#define KEY_RIGHT_ARROW_2 42 // *
+#define KEY_RIGHT_ARROW_3 62 // >
+
+#define KEY_UP_ARROW 0x103
+#define KEY_UP_ARROW_2 45 // -
+#define KEY_UP_ARROW_3 2  // DUMMY
+
+#define KEY_DOWN_ARROW 0x102
+#define KEY_DOWN_ARROW_2 61 // =
+#define KEY_DOWN_ARROW_3 3  // DUMMY
+
+#define KEY_RETURN 0x0A
+
+#define KEY_ESCAPE 0x1B
+#define KEY_ESCAPE_ALT 0x03
+
+#define KEY_SPACEBAR 0x20
+#define KEY_BACKSPACE 0x7F
+
+#endif /* KEYMAP_H */
@@ -16,6 +16,7 @@
 #include "stateclient.h"
 #include "gamelogic.h"
 #include "screens.h"
+#include "drawstats.h"
 
 
 // Store default public server endpoint in case lobby did not set app key
@@ -29,7 +30,6 @@ char localServer[] = "http://127.0.0.1:8080/";
 char query[50] = ""; //"?table=dev7";//&player=ERICAPL2";
 char playerName[12] = "";
 
-ClientState clientState;
 GameState state;
 PrefsStruct prefs;
 
@@ -41,7 +41,7 @@ uint8_t shipSize[5] = {5, 4, 3, 3, 2}; // Standard ship sizes
 
 void main(void)
 {
-    uint8_t failedApiCalls = 0;
+    uint8_t failedApiCalls = 0, update;
         char ch;
     // Testing
     // toneFinder();
@@ -90,24 +90,25 @@ void main(void)
     while (true)
     {
 
-        // Poll the server every so often.
-        if (!state.apiCallWait--)
+        // Poll the server every so often. A poll in progress is advanced every frame until it completes,
+        // so input and rendering carry on while waiting on the server
+        if (apiCallBusy() || !state.apiCallWait--)
         {
 
             // Housekeeping - allows platform specific housekeeping, like stopping Attract/screensaver mode in Atari
             housekeeping();
 
             // Poll the server
-            switch (getStateFromServer())
+            switch (update = getStateFromServer())
             {
             case STATE_UPDATE_ERROR:
                 // ERROR - Wait a bit to avoid hammering the server if getting bad responses
-                // Wait max 4 seconds (since 4*60=240 fits in a single byte)
+                // Back off for at most 4 failures, so the wait fits in a single byte
                 if (failedApiCalls < 4)
                 {
                     failedApiCalls++;
                 }
-                state.apiCallWait = 60 * failedApiCalls;
+                state.apiCallWait = nextPollWait(update, failedApiCalls);
 
                 // After consequitive failures, let the player know we are experiencing technical difficulties
                 if (failedApiCalls > 1)
@@ -121,6 +122,7 @@ void main(void)
                 break;
 
             case STATE_UPDATE_CHANGE:
+            case STATE_UPDATE_NOCHANGE:
 
                 // Clear connection failure message
                 if (failedApiCalls > 1)
@@ -128,14 +130,22 @@ void main(void)
                     drawConnectionIcon(false);
                 }
                 failedApiCalls = 0;
-                processStateChange();
 
-                // Poll again in a bit
-                state.apiCallWait = 59;
+                // Nothing to render if the server state has not changed since the last poll,
+                // unless the screen needs a redraw (e.g. just joined a table)
+                if (update == STATE_UPDATE_CHANGE || state.drawBoard)
+                    processStateChange();
+
+                // Poll again in a bit, sooner or later depending on what is happening in the game
+                state.apiCallWait = nextPollWait(update, failedApiCalls);
                 break;
             }
         }
 
         processInput();
+
+        // Draw the animation steps due this frame
+        handleAnimation();
+        drawStatsOverlay();
     }
 }
@@ -6,6 +6,7 @@
  ******************************************************************/
 
 #include "misc.h"
+#include "stateclient.h"
 
 InputStruct input;
 uint8_t _lastJoy, _joy, _joySameCount = 10;
@@ -28,7 +29,10 @@ void custom_write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, ui
 void pause(uint8_t frames)
 {
     while (frames--)
+    {
         waitvsync();
+        apiCallIdle();
+    }
 }
 
 void clearCommonInput()
@@ -171,7 +175,8 @@ void savePrefs()
 }
 
 
-uint16_t read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination)
+/// @brief Reads an appkey from the FujiNet
+static uint16_t deviceReadAppkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination)
 {
     uint16_t read = 0;
 
@@ -188,7 +193,8 @@ uint16_t read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *
     return read;
 }
 
-void write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data)
+/// @brief Writes an appkey to the FujiNet
+static void deviceWriteAppkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data)
 {
     #ifdef CUSTOM_FUJINET_CALLS
         custom_write_appkey(creator_id, app_id, key_id, count, data);
@@ -197,3 +203,97 @@ void write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t
         fuji_write_appkey(key_id, count, (uint8_t *)data);
     #endif
 }
+
+/*
+ * Appkey cache
+ * Each appkey is read from the FujiNet once and kept in RAM. Writes only change the copy,
+ * and flushAppkeys() sends the changed keys together, so toggling a setting in a menu
+ * never waits on the FujiNet. Keys that were never read, or beyond APPKEY_CACHE_MAX,
+ * go straight to the FujiNet.
+ */
+#define APPKEY_CACHE_MAX 3 // Lobby username and server, and prefs
+
+typedef struct
+{
+    uint16_t creatorId;
+    uint8_t appId, keyId;
+    uint8_t len;
+    bool dirty;
+    char data[MAX_APPKEY_LEN + 1];
+} CachedAppkey;
+
+static CachedAppkey appkeys[APPKEY_CACHE_MAX];
+static uint8_t appkeyCount;
+
+/// @brief Returns the cached copy of an appkey, or NULL if it is not cached. With load set, an appkey not cached yet is read from the FujiNet while there is room
+static CachedAppkey *cachedAppkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, bool load)
+{
+    static uint8_t i;
+    static CachedAppkey *key;
+
+    for (i = 0; i < appkeyCount; ++i)
+    {
+        key = &appkeys[i];
+        if (key->creatorId == creator_id && key->appId == app_id && key->keyId == key_id)
+            return key;
+    }
+
+    if (!load || appkeyCount == APPKEY_CACHE_MAX)
+        return NULL;
+
+    key = &appkeys[appkeyCount++];
+    key->creatorId = creator_id;
+    key->appId = app_id;
+    key->keyId = key_id;
+    key->dirty = false;
+    key->len = (uint8_t)deviceReadAppkey(creator_id, app_id, key_id, key->data);
+    return key;
+}
+
+uint16_t read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination)
+{
+    static CachedAppkey *key;
+
+    if (!(key = cachedAppkey(creator_id, app_id, key_id, true)))
+        return deviceReadAppkey(creator_id, app_id, key_id, destination);
+
+    memcpy(destination, key->data, key->len);
+    destination[key->len] = 0;
+    return key->len;
+}
+
+void write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data)
+{
+    static CachedAppkey *key;
+
+    if (count > MAX_APPKEY_LEN || !(key = cachedAppkey(creator_id, app_id, key_id, false)))
+    {
+        deviceWriteAppkey(creator_id, app_id, key_id, count, data);
+        return;
+    }
+
+    // Writing what the key already holds needs no flush
+    if (key->len == count && !memcmp(key->data, data, count))
+        return;
+
+    memcpy(key->data, data, count);
+    key->data[count] = 0;
+    key->len = (uint8_t)count;
+    key->dirty = true;
+}
+
+void flushAppkeys()
+{
+    static uint8_t i;
+    static CachedAppkey *key;
+
+    for (i = 0; i < appkeyCount; ++i)
+    {
+        key = &appkeys[i];
+        if (key->dirty)
+        {
+            key->dirty = false;
+            deviceWriteAppkey(key->creatorId, key->appId, key->keyId, key->len, key->data);
+        }
+    }
+}
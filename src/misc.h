@@ -18,9 +18,15 @@
 #include "platform-specific/input.h"
 #include "platform-specific/sound.h"
 #include "platform-specific/vars.h"
+#include "shadow.h"
 
 // Client version string to send to server
-#define API_CLIENT_VERSION "2"
+// v3: every bin payload ends with a trailer of attack events and the state version (see stateclient.h)
+// v4: the table list is paged with "offset" and "limit", and starts with the total and the page offset
+#define API_CLIENT_VERSION "4"
+
+// Version sent instead once the server turns out to be older than v3 (see stateclient.h)
+#define API_LEGACY_VERSION "2"
 
 // FujiNet AppKey settings. These should not be changed
 #define AK_LOBBY_CREATOR_ID 1   // FUJINET Lobby
@@ -32,8 +38,11 @@
 #define AK_CREATOR_ID 0xE41C // Eric Carr's creator id
 #define AK_APP_ID 5          // Battleship App ID
 #define AK_KEY_PREFS 0       // Preferences
+#define AK_KEY_DRAW_STATS 16 // First of the draw stats keys, with DRAW_STATS (see drawstats.h)
 
 #define PLAYER_MAX 4
+#define EVENT_MAX 8 // Attack events per payload, and queued for playback
+#define TABLE_PAGE 10 // Tables per page of the table list
 
 #define FUJITZEE_SCORE 14
 
@@ -64,58 +73,8 @@
 #define DRAWSHIP_SHOW 0
 #define DRAWSHIP_HIDE 1
 
-typedef struct
-{
-    char table[9];
-    char name[21];
-    char players[6];
-} Table;
-
-typedef struct
-{
-    char name[9];
-    uint8_t playerStatus;
-    uint8_t gamefield[100];
-    uint8_t shipsLeft[5];
-} Player;
-
-typedef struct
-{
-    char name[9];
-    uint8_t ready;
-} LobbyPlayer;
-
-typedef struct
-{
-    uint8_t count;
-    Table table[10];
-} Tables;
-
-typedef struct
-{
-    uint8_t playerCount;
-    char prompt[33];
-    uint8_t status;
-    uint8_t playerStatus;
-    int8_t activePlayer;
-    uint8_t moveTime;
-    uint8_t lastAttackPos;
-    // First 5 are my ships, last 5 are winner, sent at game over
-    uint8_t myShips[10];
-    Player players[PLAYER_MAX];
-} Game;
-
-typedef struct
-{
-    uint8_t playerCount;
-    char prompt[33];
-    uint8_t status;
-    uint8_t playerStatus;
-    int8_t activePlayer;
-    uint8_t moveTime;
-    char serverName[21];
-    LobbyPlayer players[PLAYER_MAX];
-} Lobby;
+// Wire layouts, generated from wire.schema
+#include "wire.h"
 
 typedef union
 {
@@ -123,9 +82,15 @@ typedef union
     Game game;
     Lobby lobby;
     Tables tables;
+    // Raw payload as received, with room for the trailer (events, seq and state version)
+    uint8_t payload[sizeof(Game) + EVENT_MAX * sizeof(AttackEvent) + 3];
 } ClientState;
 
-extern ClientState clientState;
+// Double buffered (see stateclient.h). clientState is the state on screen, and
+// prevState the one shown before it, for the renderer to compare against
+extern ClientState *clientStateFront, *clientStateBack;
+#define clientState (*clientStateFront)
+#define prevState (*clientStateBack)
 
 typedef struct
 {
@@ -144,11 +109,14 @@ typedef struct
     bool drawBoard;
     bool inGame;
 
-    // Track gamefield state - used to know when to fire shoot animation
-    uint8_t gamefield[PLAYER_MAX][100];
+    // Ready toggle not yet confirmed by the server, shown in place of the server's state
+    bool readyWanted;
+    bool readyPending;
+    bool readySent;
 
-    // Track ships left - used to know when to fire sink animation
-    uint8_t shipsLeft[PLAYER_MAX][5];
+    // Attacks received from the server that have not been animated yet
+    uint8_t eventCount;
+    AttackEvent events[EVENT_MAX];
 } GameState;
 
 typedef struct
@@ -187,11 +155,14 @@ void readCommonInput();
 void loadPrefs();
 void savePrefs();
 
-/// @brief Helper method to write to an appkey
+/// @brief Helper method to write to an appkey. An appkey read before is only sent by flushAppkeys()
 void write_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, uint16_t count, char *data);
 
 /// @brief Helper method to read from an appkey.
 /// NULL will be appended to data in case this is a string, though the length returned will not consider the NULL.
 uint16_t read_appkey(uint16_t creator_id, uint8_t app_id, uint8_t key_id, char *destination);
 
+/// @brief Sends appkeys changed by write_appkey to the FujiNet
+void flushAppkeys();
+
 #endif /* MISC_H */
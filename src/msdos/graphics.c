@@ -7,6 +7,7 @@
 
 #include <stdbool.h>
 #include <conio.h>
+#include <malloc.h>
 #include "vars.h"
 #include "../misc.h"
 #include <stdio.h>
@@ -91,6 +92,17 @@ static unsigned char inGameCharSet = 0;
  */
 static bool cursorVisible = false;
 
+/**
+ * @brief Snapshot of both CGA banks, allocated on first use.
+ * Mode 4 uses the whole 16K at B800, so there is no spare page to flip to.
+ */
+static unsigned char far *screenBak = NULL;
+
+/**
+ * @brief tile_offset at the time of the snapshot
+ */
+static unsigned char savedTileOffset = 0;
+
 /**
  * @brief plot a 8x8 2bpp tile to screen at column x, row y
  * @param tile ptr to 2bpp tile data * 8
@@ -307,22 +319,30 @@ void resetGraphics(void)
 
 /**
  * @brief Store screen buffer into secondary buffer
- * @verbose not used.
+ * @return false if there is no memory for the buffer, so the caller redraws instead
  */
 bool saveScreenBuffer()
 {
-    return false;
-    // memcpy(SCREEN_BAK, SCREEN_LOC, WIDTH * HEIGHT);
+    if (!screenBak)
+        screenBak = _fmalloc(16000);
+    if (!screenBak)
+        return false;
+
+    _fmemcpy(&screenBak[0], &video[0x0000], 8000);
+    _fmemcpy(&screenBak[8000], &video[VIDEO_ODD_OFFSET], 8000);
+    savedTileOffset = tile_offset;
+    return true;
 }
 
 /**
  * @brief Restore screen buffer from secondary buffer
- * @verbose not used.
  */
 void restoreScreenBuffer()
 {
-    // waitvsync();
-    // memcpy(SCREEN_LOC, SCREEN_BAK, WIDTH * HEIGHT);
+    waitvsync();
+    _fmemcpy(&video[0x0000], &screenBak[0], 8000);
+    _fmemcpy(&video[VIDEO_ODD_OFFSET], &screenBak[8000], 8000);
+    tile_offset = savedTileOffset;
 }
 
 /**
@@ -9,6 +9,7 @@
 #include "stateclient.h"
 #include "screens.h"
 #include "gamelogic.h"
+#include "drawstats.h"
 
 #define PLAYER_NAME_MAX 8
 #define PLAYER_BOX_TOP 13
@@ -83,8 +84,15 @@ void showHelpScreen()
 
     centerStatusText("press any key to close");
 
+    // Wait frame by frame, so a call in the background carries on
+    clearCommonInput();
+    do
+    {
+        waitvsync();
+        apiCallIdle();
+        readCommonInput();
+    } while (!input.key && !input.trigger);
     clearCommonInput();
-    cgetc();
 }
 
 /// @brief Action called in Welcome Screen to check if a server name is stored in an app key
@@ -132,7 +140,10 @@ void showPlayerNameScreen()
 
     clearCommonInput();
     while (!inputFieldCycle(WIDTH / 2 - PLAYER_NAME_MAX / 2, 17, PLAYER_NAME_MAX, playerName))
-        ;
+    {
+        waitvsync();
+        apiCallIdle();
+    }
 
     for (y = 13; y < 19; ++y)
         centerText(y, "                 ");
@@ -168,12 +179,18 @@ void welcomeActionVerifyPlayerName()
 /// @brief Shows the Welcome Screen with Logo. Asks player's name
 void showWelcomeScreen()
 {
-    // Retrieve the main player's name
-    welcomeActionVerifyPlayerName();
+    drawStatsScreen(DRAW_STATS_OTHER);
 
     // Parse server url from app key if present
     welcomeActionVerifyServerDetails();
 
+    // Without a table to join, fetch the table list while the welcome screens are up
+    if (!query[0])
+        prefetchTables();
+
+    // Retrieve the main player's name
+    welcomeActionVerifyPlayerName();
+
     // If first run, show the help screen
     if (!prefs.seenHelp)
     {
@@ -188,89 +205,252 @@ void showWelcomeScreen()
 #define TWID 26
 #define RMAR (WIDTH / 2 + TWID / 2)
 #define LMAR (WIDTH / 2 - TWID / 2)
+
+// Scrolling table list. Rows are drawn from the page of the list last received
+#define TABLE_ROWS 5
+#define TABLE_Y 9
+#define TABLE_COUNT_Y (TABLE_Y + TABLE_ROWS * 2)
+
+// What each row shows, so a refresh only redraws rows that changed. An empty name is a blank row
+static char shownName[TABLE_ROWS][21], shownPlayers[TABLE_ROWS][6];
+static uint8_t shownSelected, shownTop, shownTotal, tableTop;
+
+// The first page was requested by prefetchTables(), and may still be on its way
+static bool tablesPrefetched;
+
+/// @brief Returns the table at index in the list, or NULL if it is not in the page received
+static Table *listedTable(uint8_t index)
+{
+    index -= clientState.tables.first;
+    return index < clientState.tables.count ? &clientState.tables.table[index] : NULL;
+}
+
+/// @brief Returns true if every visible row is in the page received
+static bool tablesListed()
+{
+    static uint8_t last;
+
+    if (!clientState.tables.total)
+        return true;
+
+    last = tableTop + TABLE_ROWS - 1 < clientState.tables.total ? tableTop + TABLE_ROWS - 1 : clientState.tables.total - 1;
+    return listedTable(tableTop) && listedTable(last);
+}
+
+/// @brief Writes the path of the page of the table list with the visible rows in the middle to tempBuffer
+static void tablesPath()
+{
+    strcpy(tempBuffer, "tables?offset=");
+    itoa(tableTop > (TABLE_PAGE - TABLE_ROWS) / 2 ? tableTop - (TABLE_PAGE - TABLE_ROWS) / 2 : 0, tempBuffer + strlen(tempBuffer), 10);
+    strcat(tempBuffer, "&limit=");
+    itoa(TABLE_PAGE, tempBuffer + strlen(tempBuffer), 10);
+}
+
+/// @brief Fetches the page of the table list with the visible rows in the middle
+static void fetchTables()
+{
+    // Take the prefetched page once it arrives, asking again if it failed
+    if (tablesPrefetched)
+    {
+        tablesPrefetched = false;
+        apiCallComplete();
+        if (clientState.tables.count)
+            return;
+    }
+
+    tablesPath();
+    stateVersion = 0;
+    if (apiCall(tempBuffer) != API_CALL_SUCCESS || !clientState.tables.count)
+        clientState.tables.count = clientState.tables.total = clientState.tables.first = 0;
+}
+
+/*
+ * @brief Starts fetching the first page of the table list in the background
+ * The page is taken by the table selection screen, so it is usually there by the time the
+ * screen opens. Screens shown in the meantime advance the call with apiCallIdle()
+ */
+void prefetchTables()
+{
+    tableTop = 0;
+    clientState.tables.count = clientState.tables.total = clientState.tables.first = 0;
+
+    tablesPath();
+    stateVersion = 0;
+    tablesPrefetched = apiCallBackground(tempBuffer) == API_CALL_PENDING;
+}
+
+/// @brief Keeps index and the visible rows within the list, which may have shrunk with the last fetch. Returns index
+static uint8_t clampTables(uint8_t index)
+{
+    if (index >= clientState.tables.total)
+        index = clientState.tables.total ? clientState.tables.total - 1 : 0;
+    if (tableTop + TABLE_ROWS > clientState.tables.total)
+        tableTop = clientState.tables.total > TABLE_ROWS ? clientState.tables.total - TABLE_ROWS : 0;
+    return index;
+}
+
+/// @brief Scrolls the list so the table at index is visible, fetching another page if needed
+static void scrollTables(uint8_t index)
+{
+    if (index < tableTop)
+        tableTop = index;
+    else if (index >= tableTop + TABLE_ROWS)
+        tableTop = index - TABLE_ROWS + 1;
+
+    if (!tablesListed())
+        fetchTables();
+}
+
+/// @brief Draws the visible rows whose table or selection changed since they were last drawn
+static void drawTables(uint8_t selected)
+{
+    static uint8_t row, y, changed;
+    static Table *table;
+
+    for (row = 0; row < TABLE_ROWS; ++row)
+    {
+        y = TABLE_Y + row * 2;
+        table = listedTable(tableTop + row);
+
+        if (!table)
+        {
+            if (shownName[row][0])
+            {
+                drawSpace(LMAR, y, TWID);
+                shownName[row][0] = 0;
+            }
+            continue;
+        }
+
+        changed = strcmp(shownName[row], table->name) || strcmp(shownPlayers[row], table->players);
+        if (!changed && (row == shownSelected) == (row == selected))
+            continue;
+
+        if (changed)
+        {
+            drawSpace(LMAR, y, TWID);
+            strcpy(shownName[row], table->name);
+            strcpy(shownPlayers[row], table->players);
+        }
+
+        if (row == selected)
+        {
+            drawText(LMAR, y, table->name);
+            drawText(RMAR - 5, y, table->players);
+        }
+        else
+        {
+            drawTextAlt(LMAR, y, table->name);
+            drawTextAlt(RMAR - 5, y, table->players);
+        }
+
+        if (table->players[0] > '0')
+        {
+            drawIcon(RMAR - 7, y, ICON_PLAYER);
+        }
+    }
+    shownSelected = selected;
+
+    // Position in the list, when it is longer than the screen
+    if (shownTop != tableTop || shownTotal != clientState.tables.total)
+    {
+        shownTop = tableTop;
+        shownTotal = clientState.tables.total;
+        drawSpace(LMAR, TABLE_COUNT_Y, TWID);
+        if (shownTotal > TABLE_ROWS)
+        {
+            itoa(tableTop + 1, tempBuffer, 10);
+            strcat(tempBuffer, " to ");
+            itoa(tableTop + TABLE_ROWS, tempBuffer + strlen(tempBuffer), 10);
+            strcat(tempBuffer, " of ");
+            itoa(shownTotal, tempBuffer + strlen(tempBuffer), 10);
+            centerTextAlt(TABLE_COUNT_Y, tempBuffer);
+        }
+    }
+}
+
 /// @brief Shows a screen to select a table to join
 void showTableSelectionScreen()
 {
-    uint8_t shownCursor, tableIndex, blinkCursor, redrawScreen, i, j;
+    uint8_t tableIndex, blinkCursor, redrawScreen, i, j;
     Table *table;
     state.inGame = tableIndex = blinkCursor = 0;
+    drawStatsScreen(DRAW_STATS_OTHER);
+
+    // Keep the page prefetched while the welcome screens were up
+    if (!tablesPrefetched)
+    {
+        tableTop = 0;
+        clientState.tables.count = clientState.tables.total = clientState.tables.first = 0;
+    }
+    redrawScreen = true;
 
     resetScreen();
 
     // An empty query means a table needs to be selected
     while (strlen(query) == 0)
     {
-        // Show names of local player(s)
+        if (redrawScreen)
+        {
+            redrawScreen = false;
 
-        strcpy(tempBuffer, "HELLO ");
-        strcat(tempBuffer, playerName);
-        centerTextAlt(20, tempBuffer);
+            // Nothing is shown after clearing the screen
+            memset(shownName, 0, sizeof(shownName));
+            shownSelected = TABLE_ROWS;
+            shownTotal = 0;
 
-        if (clientState.tables.count > 0)
-        {
-            for (i = 0; i < clientState.tables.count; ++i)
-            {
-                drawSpace(LMAR, 9 + i * 2, TWID);
-            }
-        }
-        waitvsync();
-        centerText(12, "      refreshing game list..      ");
+            // Show names of local player(s)
 
-        drawLogo();
+            strcpy(tempBuffer, "HELLO ");
+            strcat(tempBuffer, playerName);
+            centerTextAlt(20, tempBuffer);
 
-        centerText(4, "choose a game to join");
-        drawText(LMAR, 7, "game");
-        drawText(RMAR - 7, 7, "players");
-        drawLine(LMAR, 8, TWID);
+            drawLogo();
 
-        // waitvsync();
+            centerText(4, "choose a game to join");
+            drawText(LMAR, 7, "game");
+            drawText(RMAR - 7, 7, "players");
+            drawLine(LMAR, 8, TWID);
 
-        clientState.tables.count = 0;
-        apiCall("tables");
+            centerStatusText("Refresh    Help     Name    Quit");
 
-        if (clientState.tables.count > 0)
-        {
-            drawSpace(LMAR, 12, TWID);
-            for (i = 0; i < clientState.tables.count; ++i)
+#ifdef COLOR_TOGGLE
+            if (prefs.color)
             {
-                table = &clientState.tables.table[i];
-                j = 9 + i * 2;
-                drawTextAlt(LMAR, j, table->name);
-                drawTextAlt(RMAR - 5, j, table->players);
-
-                if (table->players[0] > '0')
-                {
-                    drawIcon(RMAR - 7, j, ICON_PLAYER);
-                }
-                // cgetc();
+                drawLine(6, HEIGHT, 1);  // R
+                drawLine(15, HEIGHT, 1); // H
+                drawLine(21, HEIGHT, 1); // P
+                drawLine(30, HEIGHT, 1); // Q
             }
-        }
-        else
-        {
-            centerText(12, "no servers are available");
+#endif
         }
 
-        centerStatusText("Refresh    Help     Name    Quit");
+        // Refresh the rows in view. Only the rows that changed are redrawn
+        if (!clientState.tables.total)
+            centerText(12, "refreshing game list..");
 
-#ifdef COLOR_TOGGLE
-        if (prefs.color)
+        waitvsync();
+        fetchTables();
+
+        // Tables may have closed since the last refresh
+        tableIndex = clampTables(tableIndex);
+        if (!tablesListed())
+            fetchTables();
+
+        drawSpace(LMAR, 12, TWID);
+        if (!clientState.tables.total)
         {
-            drawLine(6, HEIGHT, 1);  // R
-            drawLine(15, HEIGHT, 1); // H
-            drawLine(21, HEIGHT, 1); // P
-            drawLine(30, HEIGHT, 1); // Q
+            centerText(12, "no servers are available");
         }
-#endif
-
-        shownCursor = !clientState.tables.count;
+        drawTables(tableIndex - tableTop);
 
         clearCommonInput();
-        while (!input.trigger || !clientState.tables.count)
+        while (!input.trigger || !clientState.tables.total)
         {
 
-            if (clientState.tables.count)
+            if (clientState.tables.total)
             {
-                drawIcon(LMAR - 2, 9 + tableIndex * 2, blinkCursor < 50 ? ICON_MARK : ICON_MARK_ALT);
+                drawIcon(LMAR - 2, TABLE_Y + (tableIndex - tableTop) * 2, blinkCursor < 50 ? ICON_MARK : ICON_MARK_ALT);
             }
 
             waitvsync();
@@ -284,12 +464,13 @@ void showTableSelectionScreen()
                 if (!restoreScreen())
                 {
                     resetScreen();
+                    redrawScreen = true;
                     break;
                 }
             }
             else if (input.key == 'r' || input.key == 'R')
             {
-                drawBlank(LMAR - 2, 9 + tableIndex * 2);
+                drawBlank(LMAR - 2, TABLE_Y + (tableIndex - tableTop) * 2);
                 break;
             }
             else if (input.key == 'c' || input.key == 'C')
@@ -297,6 +478,7 @@ void showTableSelectionScreen()
                 cycleNextColor();
                 savePrefs();
 #ifdef COLOR_CYCLE_REQUIRES_REDRAW
+                redrawScreen = true;
                 break;
 #endif
             }
@@ -310,60 +492,56 @@ void showTableSelectionScreen()
             {
                 showPlayerNameScreen();
                 resetScreen();
+                redrawScreen = true;
                 break;
             }
             else if (input.key == 'q' || input.key == 'Q')
             {
+                flushAppkeys();
                 quit();
             } /*else if (input.key != 0) {
                 itoa(input.key, tempBuffer, 10);
                 drawStatusText(tempBuffer);
             }*/
 
-            if (!shownCursor || (clientState.tables.count > 0 && input.dirY))
+            if (clientState.tables.total > 0 && input.dirY)
             {
-
                 // Visually unselect old table
-                table = &clientState.tables.table[tableIndex];
-                j = table->name[0]; // Reference table so cmoc 0.1.96 optimizer does not corrupt memory
-                j = 9 + tableIndex * 2;
+                drawBlank(LMAR - 2, TABLE_Y + (tableIndex - tableTop) * 2);
 
-                drawBlank(LMAR - 2, j);
-                drawTextAlt(LMAR, j, table->name);
-                drawTextAlt(RMAR - 5, j, table->players);
-
-                // Move table index to new table
-                tableIndex = (input.dirY + tableIndex + clientState.tables.count) % clientState.tables.count;
+                // Move table index to new table, scrolling the list if it is out of view
+                tableIndex = (input.dirY + tableIndex + clientState.tables.total) % clientState.tables.total;
+                scrollTables(tableIndex);
+                tableIndex = clampTables(tableIndex);
 
                 // Visually select new table
-
-                table = &clientState.tables.table[tableIndex];
-                j = table->name[0]; // Reference table so cmoc 0.1.96 optimizer does not corrupt memory
-                j = 9 + tableIndex * 2;
-
-                drawIcon(LMAR - 2, j, ICON_MARK);
-                drawText(LMAR, j, table->name);
-                drawText(RMAR - 5, j, table->players);
+                drawTables(tableIndex - tableTop);
+                if (clientState.tables.total)
+                    drawIcon(LMAR - 2, TABLE_Y + (tableIndex - tableTop) * 2, ICON_MARK);
 
                 soundCursor();
 
                 // Housekeeping - allows platform specific housekeeping, like stopping Attract/screensaver mode in Atari
                 housekeeping();
-
-                shownCursor = 1;
             }
         }
 
         if (input.trigger)
         {
+            // The table is not in the page received if the list changed or a fetch failed, so show it again
+            table = listedTable(tableIndex);
+            if (!table)
+                continue;
+
             soundSelect();
+            j = table->name[0]; // Reference table so cmoc 0.1.96 optimizer does not corrupt memory
 
             // Clear screen and write server name
             resetScreen();
-            centerText(15, clientState.tables.table[tableIndex].name);
+            centerText(15, table->name);
 
             strcpy(query, "?table=");
-            strcat(query, clientState.tables.table[tableIndex].table);
+            strcat(query, table->table);
 
             // Combine server endpoint and query for final base url
             strcpy(tempBuffer, serverEndpoint);
@@ -377,6 +555,9 @@ void showTableSelectionScreen()
     centerTextAlt(17, "connecting to server");
     progressAnim(19);
 
+    // Save settings, name and server changed since the game started
+    flushAppkeys();
+
     // Append player name to query
     strcat(query, "&player=");
     strcat(query, playerName);
@@ -390,11 +571,13 @@ void showTableSelectionScreen()
     // Reset the game state
     clearRenderState();
     state.waitingOnEndGameContinue = false;
+    state.readyPending = false;
 
-    // Clear gamefield
-    memset(state.gamefield, 0, sizeof(state.gamefield));
-
-    // Join table
+    // Join table, forcing a full payload with no event history or moves from a previous game.
+    // Any call still in progress is completed first, so its reply cannot set them again
+    apiCallComplete();
+    stateVersion = eventSeq = state.eventCount = 0;
+    sendMove(NULL);
     apiCall("state");
 
     // Reduce wait count for an immediate call
@@ -408,6 +591,9 @@ void showInGameMenuScreen()
 {
     static uint8_t y, i, wait;
 
+    // Finish drawing any effect that is playing, as the menu covers the board
+    skipAnimations();
+    drawStatsScreen(DRAW_STATS_MENU);
     saveScreen();
     state.inGame = false;
     i = wait = 1;
@@ -465,8 +651,11 @@ void showInGameMenuScreen()
                 resetScreen();
                 centerText(10, "please wait");
 
+                drawStatsDump();
+
                 //  Clear server app key in case of reboot
                 write_appkey(AK_LOBBY_CREATOR_ID, AK_LOBBY_APP_ID, AK_LOBBY_KEY_SERVER, 0, (char *)"");
+                flushAppkeys();
 
                 // Inform server player is leaving
                 apiCall("leave");
@@ -482,6 +671,9 @@ void showInGameMenuScreen()
         }
     }
 
+    // Save settings changed in the menu
+    flushAppkeys();
+
     // Show game screen again before returning
 
     clearCommonInput();
@@ -492,4 +684,5 @@ void showInGameMenuScreen()
         clearRenderState();
         processStateChange();
     }
+    drawStatsScreen(DRAW_STATS_RESUME);
 }
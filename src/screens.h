@@ -31,6 +31,9 @@ void welcomeActionVerifyPlayerName();
 /// @brief Shows the Welcome Screen with Logo. Asks player's name
 void showWelcomeScreen();
 
+/// @brief Starts fetching the table list in the background, for the table selection screen
+void prefetchTables();
+
 /// @brief Shows a screen to select a table to join
 void showTableSelectionScreen();
 
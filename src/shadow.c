@@ -0,0 +1,57 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#include "misc.h"
+
+#ifdef SHADOW_TILES
+
+uint8_t shadowTiles[WIDTH * HEIGHT];
+
+// Rows changed since they were last flushed, and where the next flush resumes
+static uint8_t rowChanged[HEIGHT], changedRows, nextRow;
+
+void shadowTouch(uint8_t y, uint8_t rows)
+{
+    while (rows-- && y < HEIGHT)
+    {
+        if (!rowChanged[y])
+        {
+            rowChanged[y] = 1;
+            changedRows++;
+        }
+        y++;
+    }
+}
+
+void shadowTouchAt(uint8_t *pos, uint8_t rows)
+{
+    shadowTouch((uint8_t)((uint16_t)(pos - shadowTiles) / WIDTH), rows);
+}
+
+void shadowFlush(uint8_t *video)
+{
+    static uint8_t budget;
+
+    budget = SHADOW_FLUSH_ROWS;
+    while (changedRows && budget)
+    {
+        if (rowChanged[nextRow])
+        {
+            rowChanged[nextRow] = 0;
+            changedRows--;
+            budget--;
+
+            // A whole row is quicker to copy than to compare cell by cell
+            memcpy(video + nextRow * WIDTH, shadowTiles + nextRow * WIDTH, WIDTH);
+        }
+
+        if (++nextRow == HEIGHT)
+            nextRow = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*******************************************************************
+ *
+ * Do NOT include standard library headers (e.g. conio, std*).
+ * Instead, add to standard_lib.h, which gets included in misc.h
+ *
+ ******************************************************************/
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+/*
+ * Shadow tile map
+ * Optional for platforms with a character mapped screen. Define SHADOW_TILES in the
+ * platform's vars.h, and its graphics.c draws into shadowTiles instead of video memory,
+ * calling shadowTouch() for the rows each draw changes. Its waitvsync() then calls
+ * shadowFlush() once the vertical blank starts, which copies only the changed rows to
+ * video memory. Cells redrawn several times in a frame reach the screen once, and not
+ * while the beam is drawing them.
+ *
+ * SHADOW_FLUSH_ROWS caps the rows copied per flush (default all), to bound the work
+ * in each vertical blank. Rows left over are flushed in the next frame.
+ */
+#ifdef SHADOW_TILES
+
+#ifndef SHADOW_FLUSH_ROWS
+#define SHADOW_FLUSH_ROWS HEIGHT
+#endif
+
+extern uint8_t shadowTiles[WIDTH * HEIGHT];
+
+/// @brief Marks rows of the shadow map as changed, starting at row Y
+void shadowTouch(uint8_t y, uint8_t rows);
+
+/// @brief Marks rows of the shadow map as changed, starting at the row holding pos
+void shadowTouchAt(uint8_t *pos, uint8_t rows);
+
+/// @brief Copies the changed rows to video memory
+void shadowFlush(uint8_t *video);
+
+#else
+#define shadowTouch(y, rows)
+#define shadowTouchAt(pos, rows)
+#endif
+
+#endif /* SHADOW_H */
@@ -26,6 +26,21 @@ unsigned char kbhit (void);
  */
 char cgetc (void);
 
+#elif defined(__linux__)
+// Headless Linux host build. There is no conio, so src/linux provides these
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* (Non blocking) Return true if there's a key waiting */
+int kbhit(void);
+
+/* (Blocking) Return a key, with arrow keys mapped to KEY_*_ARROW */
+int cgetc(void);
+
+char *itoa(int value, char *s, int radix);
+
 #else
 // Standard libraries
 #include <conio.h>
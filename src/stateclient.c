@@ -11,76 +11,1155 @@
 
 // Internal to this file
 static char url[160];
-char *requestedMove;
+uint8_t stateVersion;
+uint8_t eventSeq;
+
+// Frames to wait before the next poll, indexed by POLL_* (see stateclient.h)
+uint8_t pollPolicy[] = {
+    59,  // POLL_DEFAULT
+    20,  // POLL_COUNTDOWN
+    15,  // POLL_AFTER_MOVE
+    120, // POLL_OPPONENT
+    180, // POLL_SPECTATOR
+    55,  // POLL_ERROR (per consecutive failure)
+    20,  // POLL_JITTER
+    2    // POLL_LONGPOLL
+};
+
+static uint8_t fastPolls, opponentSeconds;
+
+// Moves not yet acknowledged by the server, oldest first
+static char outbox[OUTBOX_MAX][OUTBOX_MOVE_LEN];
+static uint8_t outboxId[OUTBOX_MAX];
+static uint8_t outboxCount, outboxTries, moveId;
+
+// Set by trailerStart() when the payload holds packed boards
+static bool packedBoards;
+
+// Set once a full payload came as a server older than v3 sends it, to speak v2 for the rest of the run
+static bool legacyServer;
+
+// Api call in progress
+#define PHASE_IDLE 0
+#define PHASE_HEADER 1 // Keep-alive session only: reading the HTTP response header
+#define PHASE_HEAD 2   // Waiting on the first byte, which decides where the rest goes
+#define PHASE_BODY 3   // Waiting until the rest of the body can be read in one go
+
+// Frames to wait without receiving anything before a call is abandoned
+#define API_TIMEOUT_FRAMES 600
+
+// Device error reported by network_status() once a response has been read to the end
+#define NETWORK_EOF 136
+
+static uint8_t phase, head;
+static uint8_t *dest;
+static uint16_t space, received, idleFrames, callFrames;
+static bool bodyEnd; // Set by apiAvailable() once no more of the body will arrive
+static bool longPoll;
+static uint8_t callMoveId; // Outbox move being sent, or 0 for any other call
+static uint8_t waitAt;     // Offset in url where "&wait=" is appended for a long-poll
+static bool backgroundCall; // Started by apiCallBackground(), advanced by apiCallIdle()
+static bool tablesCall; // Fetching a page of the table list, rather than a table's state
+
+// Header chunks and unchanged/delta replies are received here, so clientState stays intact
+static uint8_t reply[DELTA_MAX];
+
+// Double buffered state, see stateclient.h
+#define BACK_SAME 0  // The back buffer matches the front
+#define BACK_DELTA 1 // The front is the back buffer patched with lastDelta
+#define BACK_STALE 2 // The back buffer differs from the front, so copy it all
+
+static ClientState clientStates[2];
+ClientState *clientStateFront = &clientStates[0], *clientStateBack = &clientStates[1];
+static ClientState *receiving; // Buffer the full payload in progress goes into
+static bool frontShown = true;
+static uint8_t backState;
+#ifdef STATE_DELTA_REPLAY
+static uint8_t lastDelta[DELTA_MAX], lastDeltaLen;
+#endif
 
 #ifdef CUSTOM_FUJINET_CALLS
 // Optional: This would be implemented in platform-specific code for emulators, etc
-int16_t custom_network_call(char *url, uint8_t *buffer, uint16_t max_len);
+uint8_t custom_network_open(char *url);
+int16_t custom_network_read(uint8_t *buffer, uint16_t len);
+void custom_network_close();
+
+#define network_open(devicespec, mode, trans) custom_network_open(devicespec)
+#define network_close(devicespec) custom_network_close()
+#define DISABLE_KEEPALIVE
 #endif
 
+#ifdef API_TRACE
 /*
- * @brief Makes an Api call, returning true if valid payload received
- * Returns API_CALL_*:
- *  1 - successfully received a payload
- *  2 - async - received payload, still in process, call for more data
- *  0 - error - aborted
+ * Api trace, implemented in platform-specific code (see src/linux/trace.c)
+ * traceCapture() is handed each complete response body as received, before it is decoded.
+ * When a trace is being replayed, traceOpen() takes the next recorded response in place of
+ * calling the server, and the call reads it through traceAvailable() and traceRead(), which
+ * behave as apiAvailable() and apiRead(). Replayed responses go through the same decoding
+ * as live ones, so processStateChange() sees identical state on every run.
  */
-uint8_t apiCall(const char *path)
+bool traceOpen(const char *url);
+int16_t traceAvailable(uint16_t len);
+int16_t traceRead(uint8_t *buf, uint16_t len);
+void traceCapture(const char *url, uint8_t head, const uint8_t *body, uint16_t len);
+
+static bool replaying;
+#endif
+
+#ifndef DISABLE_KEEPALIVE
+/*
+ * Keep-alive session
+ * For plain http:// endpoints, requests are written as HTTP/1.1 over a single N: TCP
+ * channel that stays open across polls, so connection setup is only paid once.
+ * FujiNet TCP channels have no TLS, so https:// endpoints open the url on every call.
+ * The end of each body is found from its Content-Length, so a server that leaves it out
+ * is sent every call that way too, from its first reply on.
+ * Platforms that cannot send plain ASCII over TCP define DISABLE_KEEPALIVE in vars.h
+ */
+#define SESSION_NONE 0
+#define SESSION_OK 1
+#define SESSION_FAILED 2
+
+#define HEADER_MORE 0
+#define HEADER_DONE 1
+#define HEADER_BAD 2
+
+static char sessionSpec[56];   // n:tcp://host:port/
+static char sessionHeader[68]; // " HTTP/1.1" CRLF "Host: host:port" CRLF CRLF
+static uint8_t sessionTarget;  // Offset in url where the request target begins
+static bool sessionOpen, sessionReused;
+static bool sessionNoLength;   // Set once a reply came without Content-Length, which the session needs
+static uint8_t useSession;
+static uint8_t *spill;         // Body bytes received along with the header, kept in reply
+static uint8_t spillLen;
+static uint16_t bodyLeft;
+static const char contentLength[] = "content-length:";
+
+// Header scanner state, kept across ticks
+static uint8_t hdrPos, hdrMatch, hdrCrLf;
+static bool hdrOk, hdrFirstLine, hdrLength;
+
+static void appendCrLf(char *s)
+{
+    s += strlen(s);
+    *s++ = 13;
+    *s++ = 10;
+    *s = 0;
+}
+
+static void sessionClose()
+{
+    if (sessionOpen)
+    {
+        network_close(sessionSpec);
+        sessionOpen = false;
+    }
+}
+
+/// @brief Returns true if the endpoint is plain http and sends Content-Length, so the keep-alive session can be used
+static bool sessionCapable()
+{
+    static uint8_t i;
+
+    if (sessionNoLength)
+        return false;
+
+    for (i = 0; i < 7; ++i)
+    {
+        if (serverEndpoint[i] != "http://"[i])
+            return false;
+    }
+    return true;
+}
+
+/// @brief Opens the TCP channel to the server. Returns false if the endpoint is not plain http
+static bool sessionConnect()
+{
+    static char *host;
+    static uint8_t len, i;
+    static bool hasPort;
+
+    if (!sessionCapable())
+        return false;
+
+    // Split "http://host[:port]/base/" into the host and the request target base
+    host = serverEndpoint + 7;
+    hasPort = false;
+    for (len = 0; host[len] && host[len] != '/'; ++len)
+    {
+        if (host[len] == ':')
+            hasPort = true;
+    }
+    sessionTarget = 2 + 7 + len;
+
+    strcpy(sessionSpec, "n:tcp://");
+    memcpy(sessionSpec + 8, host, len);
+    sessionSpec[8 + len] = 0;
+    strcat(sessionSpec, hasPort ? "/" : ":80/");
+
+    strcpy(sessionHeader, " HTTP/1.1");
+    appendCrLf(sessionHeader);
+    strcat(sessionHeader, "Host: ");
+    i = (uint8_t)strlen(sessionHeader);
+    memcpy(sessionHeader + i, host, len);
+    sessionHeader[i + len] = 0;
+    appendCrLf(sessionHeader);
+    appendCrLf(sessionHeader);
+
+    sessionReused = false;
+    return sessionOpen = !network_open(sessionSpec, OPEN_MODE_RW, OPEN_TRANS_NONE);
+}
+
+/// @brief Writes the request in url to the session, reconnecting once if the channel fails
+static uint8_t sessionRequest()
+{
+    static uint8_t attempt;
+
+    hdrPos = hdrMatch = hdrCrLf = hdrOk = hdrLength = 0;
+    hdrFirstLine = true;
+    bodyLeft = spillLen = 0;
+
+    for (attempt = 0; attempt < 2; ++attempt)
+    {
+        if (!sessionOpen && !sessionConnect())
+            return SESSION_NONE;
+
+        if (!network_write(sessionSpec, (uint8_t *)"GET ", 4) &&
+            !network_write(sessionSpec, (uint8_t *)url + sessionTarget, strlen(url + sessionTarget)) &&
+            !network_write(sessionSpec, (uint8_t *)sessionHeader, strlen(sessionHeader)))
+            return SESSION_OK;
+
+        sessionClose();
+    }
+
+    return SESSION_FAILED;
+}
+
+/// @brief Returns the bytes waiting on the session, or -1 if the server closed it
+static int16_t sessionWaiting()
+{
+    static uint16_t bw;
+    static uint8_t conn, err;
+
+    if (network_status(sessionSpec, &bw, &conn, &err))
+        return -1;
+
+    return bw ? (int16_t)bw : conn ? 0 : -1;
+}
+
+/// @brief Scans n header bytes in reply. Anything after the blank line is kept as the start of the body
+static uint8_t sessionScanHeader(uint8_t n)
+{
+    static uint8_t i, c;
+
+    for (i = 0; i < n; ++i)
+    {
+        c = reply[i];
+        if (c == 13 || c == 10)
+        {
+            if (++hdrCrLf == 4)
+            {
+                spill = reply + i + 1;
+                spillLen = n - i - 1;
+                return hdrOk && bodyLeft ? HEADER_DONE : HEADER_BAD;
+            }
+            hdrPos = hdrMatch = hdrFirstLine = 0;
+            continue;
+        }
+
+        hdrCrLf = 0;
+        if (hdrFirstLine)
+        {
+            // "HTTP/1.1 200 OK"
+            if (hdrPos == 9)
+                hdrOk = c == '2';
+        }
+        else if (hdrMatch < sizeof(contentLength) - 1)
+        {
+            hdrMatch = (c | 0x20) == contentLength[hdrMatch] ? hdrMatch + 1 : 0xFF;
+        }
+        else if (hdrMatch == sizeof(contentLength) - 1 && c >= '0' && c <= '9')
+        {
+            bodyLeft = bodyLeft * 10 + c - '0';
+            hdrLength = true;
+        }
+        hdrPos++;
+    }
+
+    return HEADER_MORE;
+}
+#endif
+
+/// @brief Returns how many bytes can be read right now (up to len), 0 if none yet, -1 on error.
+/// When wholeBody is set, sets bodyEnd once nothing more of the response will arrive after
+/// the bytes returned. The keep-alive session, which knows the body length, returns 0 until
+/// all of it has arrived
+static int16_t apiAvailable(uint16_t len, bool wholeBody)
+{
+    static int16_t n;
+#ifndef CUSTOM_FUJINET_CALLS
+    static uint16_t bw;
+    static uint8_t conn, err;
+#endif
+
+#ifdef API_TRACE
+    // The recorded body is all there once it is due
+    if (replaying)
+    {
+        n = traceAvailable(len);
+        bodyEnd = n > 0;
+        return n;
+    }
+#endif
+
+#ifndef DISABLE_KEEPALIVE
+    if (useSession)
+    {
+        if (len > bodyLeft)
+            len = bodyLeft;
+
+        n = spillLen;
+        if (n < len)
+        {
+            if ((n = sessionWaiting()) < 0)
+                return -1;
+            n += spillLen;
+        }
+        if (n < len)
+            return wholeBody ? 0 : n;
+        bodyEnd = true;
+        return len;
+    }
+#endif
+
+#ifdef CUSTOM_FUJINET_CALLS
+    // The emulator bridge has the whole response on disk once the call is opened
+    bodyEnd = true;
+    return len;
+#else
+    if (network_status(url, &bw, &conn, &err))
+        return -1;
+
+    // The body is read as it arrives, and has ended once nothing is waiting and the channel
+    // reports it is done or at EOF. Before the first byte, that means there was no reply.
+    // network_read() stops at the same EOF for http and https alike, which the client always
+    // relied on to read payloads shorter than asked for. Were it never reported, the call
+    // would time out after API_TIMEOUT_FRAMES rather than hang
+    if (!bw)
+    {
+        if (conn && err != NETWORK_EOF)
+            return 0;
+        if (!wholeBody)
+            return -1;
+        bodyEnd = true;
+        return 0;
+    }
+    return bw < len ? bw : len;
+#endif
+}
+
+/// @brief Reads up to len bytes that apiAvailable() reported as waiting
+static int16_t apiRead(uint8_t *buf, uint16_t len)
+{
+#ifndef DISABLE_KEEPALIVE
+    static uint16_t got;
+#endif
+
+#ifdef API_TRACE
+    if (replaying)
+        return traceRead(buf, len);
+#endif
+
+#ifndef DISABLE_KEEPALIVE
+    if (useSession)
+    {
+        // Body bytes that arrived with the header come first. Copy forward, as buf may overlap
+        got = 0;
+        while (spillLen && got < len)
+        {
+            buf[got++] = *spill++;
+            spillLen--;
+        }
+
+        if (got < len && network_read_nb(sessionSpec, buf + got, len - got) != (int16_t)(len - got))
+            return -1;
+
+        bodyLeft -= len;
+        return len;
+    }
+#endif
+
+#ifdef CUSTOM_FUJINET_CALLS
+    return custom_network_read(buf, len);
+#else
+    return network_read_nb(url, buf, len);
+#endif
+}
+
+/// @brief Patches the game in buf with len bytes of delta records. Returns false if malformed
+static bool applyDelta(ClientState *buf, uint8_t *rec, uint8_t len)
+{
+    static uint8_t *end;
+    static uint16_t offset;
+
+    end = rec + len;
+
+    // Each record is [offset lo][offset hi][length][bytes..] into the Game struct
+    while (rec + 3 <= end)
+    {
+        offset = rec[0] | (rec[1] << 8);
+        if (offset + rec[2] > sizeof(Game) || rec + 3 + rec[2] > end)
+            return false;
+
+        memcpy(buf->payload + offset, rec + 3, rec[2]);
+        rec += 3 + rec[2];
+    }
+
+    return rec == end;
+}
+
+/// @brief Brings the back buffer up to the front buffer
+static void syncBack()
+{
+    switch (backState)
+    {
+#ifdef STATE_DELTA_REPLAY
+    case BACK_DELTA:
+        applyDelta(clientStateBack, lastDelta, lastDeltaLen);
+        break;
+#endif
+    case BACK_STALE:
+        memcpy(clientStateBack, clientStateFront, sizeof(Game));
+        break;
+    }
+    backState = BACK_SAME;
+}
+
+/// @brief Makes the back buffer the front, once a new state was received into it
+static void swapState()
+{
+    static ClientState *front;
+
+    front = clientStateFront;
+    clientStateFront = clientStateBack;
+    clientStateBack = front;
+}
+
+void stateShown()
+{
+    frontShown = true;
+    syncBack();
+}
+
+/// @brief Closes the call in progress and returns result
+static uint8_t apiCallEnd(uint8_t result)
+{
+#ifdef API_TRACE
+    if (replaying)
+        replaying = false;
+    else
+#endif
+#ifndef DISABLE_KEEPALIVE
+    // Drop the session if it failed or unread bytes would corrupt the next response
+    if (useSession)
+    {
+        if (result == API_CALL_ERROR || bodyLeft)
+            sessionClose();
+        else
+            sessionReused = true;
+    }
+    else
+#endif
+        network_close(url);
+
+    phase = PHASE_IDLE;
+    return result;
+}
+
+/*
+ * @brief Returns the length of what precedes the trailer at the end of len received bytes,
+ * or TRAILER_BAD if malformed. Sets packedBoards, and leaves the trailer to takeTrailer()
+ */
+static uint16_t trailerStart(uint8_t *buf, uint16_t len)
+{
+    static uint8_t count;
+
+    if (len < 3)
+        return TRAILER_BAD;
+
+    count = buf[len - 3];
+    packedBoards = (count & TRAILER_PACKED) != 0;
+    count &= ~TRAILER_PACKED;
+    if (count > EVENT_MAX || len < 3 + count * sizeof(AttackEvent))
+        return TRAILER_BAD;
+
+    return len - 3 - count * sizeof(AttackEvent);
+}
+
+/// @brief Takes the trailer between start (from trailerStart) and len, queuing its events for playback
+static void takeTrailer(uint8_t *buf, uint16_t start, uint16_t len)
+{
+    static uint8_t count, i, j;
+    static uint8_t *ev;
+
+    stateVersion = buf[len - 1];
+    eventSeq = buf[len - 2];
+    count = (uint8_t)((len - 3 - start) / sizeof(AttackEvent));
+
+    ev = buf + start;
+    for (i = 0; i < count; i++)
+    {
+        // A full queue drops its oldest event
+        if (state.eventCount == EVENT_MAX)
+        {
+            for (j = 1; j < EVENT_MAX; j++)
+            {
+                state.events[j - 1] = state.events[j];
+            }
+            state.eventCount--;
+        }
+
+        memcpy(&state.events[state.eventCount++], ev, sizeof(AttackEvent));
+        ev += sizeof(AttackEvent);
+    }
+}
+
+/// @brief Unpacks a 25 byte board into 100 cells. dest may overlap src as long as it does not start before it
+static void unpackGamefield(uint8_t *dest, uint8_t *src)
+{
+    static uint8_t i, b;
+
+    // Back to front, so no packed byte is overwritten before it is read
+    src += 25;
+    dest += 100;
+    for (i = 25; i; i--)
+    {
+        b = *--src;
+        *--dest = b >> 6;
+        *--dest = (b >> 4) & 3;
+        *--dest = (b >> 2) & 3;
+        *--dest = b & 3;
+    }
+}
+
+#define PACKED_PLAYER_SIZE (sizeof(Player) - 75)
+
+/// @brief Expands the packed boards of the game payload in place, once payloadSize() has checked its length
+static void unpackGame()
+{
+    static uint8_t *players, *src;
+    static Player *dest;
+    static uint8_t i;
+
+    players = (uint8_t *)receiving->game.players;
+
+    // Last player first, as each one moves further up over the packed data than the one before
+    for (i = receiving->game.playerCount; i--;)
+    {
+        src = players + i * PACKED_PLAYER_SIZE;
+        dest = &receiving->game.players[i];
+
+        memcpy(dest->shipsLeft, src + PACKED_PLAYER_SIZE - 5, 5);
+        unpackGamefield(dest->gamefield, src + 10);
+
+        // Name and player status are already in place for the first player
+        if (i)
+            memcpy(dest, src, 10);
+    }
+}
+
+/*
+ * @brief Returns the length the full payload in receiving should have before its trailer, or as
+ * a server older than v3 sends it if legacy. Returns TRAILER_BAD if the counts are out of range
+ */
+static uint16_t payloadSize(bool legacy)
+{
+    if (tablesCall)
+        return receiving->tables.count > TABLE_PAGE ? TRAILER_BAD : (legacy ? 1 : 3) + receiving->tables.count * sizeof(Table);
+
+    if (receiving->game.playerCount > PLAYER_MAX)
+        return TRAILER_BAD;
+
+    if (receiving->game.status == STATUS_LOBBY)
+        return (uint16_t)((uint8_t *)receiving->lobby.players - receiving->payload) + receiving->lobby.playerCount * sizeof(LobbyPlayer);
+
+    return (uint16_t)((uint8_t *)receiving->game.players - receiving->payload) + receiving->game.playerCount * (packedBoards && !legacy ? PACKED_PLAYER_SIZE : sizeof(Player));
+}
+
+/// @brief Decodes the received response once the whole body has been read
+static uint8_t apiCallFinish(uint16_t read)
+{
+    static uint16_t len;
+
+    switch (head)
+    {
+    case RESPONSE_NOCHANGE:
+        stateVersion = reply[0];
+        return API_CALL_NOCHANGE;
+
+    case RESPONSE_DELTA:
+        len = trailerStart(reply, read);
+        if (len == TRAILER_BAD)
+        {
+            stateVersion = 0;
+            return API_CALL_ERROR;
+        }
+        takeTrailer(reply, len, read);
+        read = len;
+
+        // Patch the state on screen into the back buffer and swap, or the front buffer in place
+        // if that was not shown yet. A partially applied delta leaves the state unknown, so ask
+        // for a full payload next time
+        if (frontShown)
+        {
+            syncBack();
+            backState = BACK_STALE;
+            if (!applyDelta(clientStateBack, reply, (uint8_t)read))
+            {
+                stateVersion = 0;
+                return API_CALL_ERROR;
+            }
+            swapState();
+#ifdef STATE_DELTA_REPLAY
+            memcpy(lastDelta, reply, read);
+            lastDeltaLen = (uint8_t)read;
+            backState = BACK_DELTA;
+#endif
+            frontShown = false;
+        }
+        else
+        {
+            // The back buffer is now more than one delta behind, so copy it all once shown
+            backState = BACK_STALE;
+            if (!applyDelta(clientStateFront, reply, (uint8_t)read))
+            {
+                stateVersion = 0;
+                return API_CALL_ERROR;
+            }
+        }
+        return API_CALL_SUCCESS;
+    }
+
+    receiving->firstByte = head;
+    read++;
+    len = trailerStart(receiving->payload, read);
+
+    // A server older than v3 ignores "v" and sends payloads unpacked and without a trailer,
+    // so fall back to v2 once a payload fits that and not a trailer
+    if (!legacyServer && len != payloadSize(false) && read == payloadSize(true))
+        legacyServer = true;
+
+    if (legacyServer ? read != payloadSize(true) : len == TRAILER_BAD || len < payloadSize(false))
+    {
+        // Drop the bad payload, never the state on screen, and ask for a full one next time
+        receiving->firstByte = 0;
+        stateVersion = 0;
+        return API_CALL_ERROR;
+    }
+
+    if (legacyServer)
+    {
+        // Left at 0, so no "ver", "ev" or "wait" is sent, and every poll returns the full payload
+        stateVersion = eventSeq = 0;
+
+        // Make room for the total and the index of the first table that start a v4 page
+        if (tablesCall)
+        {
+            for (len = receiving->tables.count * sizeof(Table); len--;)
+                receiving->payload[3 + len] = receiving->payload[1 + len];
+            receiving->tables.total = receiving->tables.count;
+            receiving->tables.first = 0;
+        }
+    }
+    else
+    {
+        // Before the boards are unpacked over it
+        takeTrailer(receiving->payload, len, read);
+        if (packedBoards)
+            unpackGame();
+    }
+
+    if (receiving == clientStateBack)
+        swapState();
+    frontShown = false;
+    return API_CALL_SUCCESS;
+}
+
+/// @brief Sends the call in url by opening it, without the keep-alive session. Returns API_CALL_PENDING or API_CALL_ERROR
+static uint8_t apiCallOpen()
+{
+    // Opening a url blocks until the server replies, so never hold the client for a long-poll
+    url[waitAt] = 0;
+    longPoll = false;
+
+    // Allow platform-specific override (e.g. for mocking network calls in emulator)
+    if (network_open(url, OPEN_MODE_HTTP_GET, OPEN_TRANS_NONE))
+    {
+        phase = PHASE_IDLE;
+        return API_CALL_ERROR;
+    }
+
+    phase = PHASE_HEAD;
+    return API_CALL_PENDING;
+}
+
+/*
+ * @brief Starts an Api call. Call apiCallTick() every frame until it no longer returns API_CALL_PENDING
+ * Returns API_CALL_PENDING, or API_CALL_ERROR if the request could not be sent
+ */
+uint8_t apiCallBegin(const char *path)
 {
-    static int16_t read;
+    backgroundCall = false;
+    tablesCall = !strncmp(path, "tables", 6);
 
     strcpy(url, "n:");
     strcat(url, serverEndpoint);
     strcat(url, path);
     strcat(url, query);
-    strcat(url, query[0] ? "&bin=1&v=" API_CLIENT_VERSION : "?bin=1&v=" API_CLIENT_VERSION);
+    strcat(url, strchr(url, '?') ? "&" : "?");
+    strcat(url, legacyServer ? "bin=1&v=" API_LEGACY_VERSION : "bin=2&v=" API_CLIENT_VERSION);
 
-    // Allow platform-specific override (e.g. for mocking network calls in emulator)
-#ifdef CUSTOM_FUJINET_CALLS
-    read = custom_network_call(url, &clientState.firstByte, sizeof(clientState.game));
-#else
-    if (network_open(url, OPEN_MODE_HTTP_GET, OPEN_TRANS_NONE))
+    if (stateVersion)
+    {
+        strcat(url, "&ver=");
+        itoa(stateVersion, url + strlen(url), 10);
+    }
+
+    if (eventSeq)
+    {
+        strcat(url, "&ev=");
+        itoa(eventSeq, url + strlen(url), 10);
+    }
+
+    if (callMoveId)
+    {
+        strcat(url, "&mid=");
+        itoa(callMoveId, url + strlen(url), 10);
+    }
+
+    // Long-poll: the server holds the reply until the state changes or the wait runs out
+    waitAt = (uint8_t)strlen(url);
+    if (longPoll)
+        strcat(url, "&wait=" LONGPOLL_SECONDS);
+
+    head = 0;
+    idleFrames = callFrames = 0;
+
+#ifdef API_TRACE
+    if ((replaying = traceOpen(url)))
     {
+        longPoll = false;
+        phase = PHASE_HEAD;
+        return API_CALL_PENDING;
+    }
+#endif
+
+#ifndef DISABLE_KEEPALIVE
+    // Prefer the keep-alive session, falling back to opening the url for this call
+    useSession = sessionRequest();
+    if (useSession == SESSION_FAILED)
         return API_CALL_ERROR;
+
+    if (useSession)
+    {
+        phase = PHASE_HEADER;
+        return API_CALL_PENDING;
     }
+#endif
+
+    return apiCallOpen();
+}
 
-    read = network_read(url, &clientState.firstByte, sizeof(clientState.game));
-    network_close(url);
+/*
+ * @brief Advances the Api call in progress without blocking
+ * Returns API_CALL_*:
+ *  1 - successfully received a payload (full or delta)
+ *  2 - async - still waiting on the server, call again next frame
+ *  3 - server state unchanged since stateVersion, clientState left as is
+ *  0 - error - aborted, or no call in progress
+ */
+uint8_t apiCallTick()
+{
+    static int16_t n;
+
+    callFrames++;
+    switch (phase)
+    {
+    case PHASE_IDLE:
+        return API_CALL_ERROR;
+
+#ifndef DISABLE_KEEPALIVE
+    case PHASE_HEADER:
+        n = sessionWaiting();
+        if (n > 0)
+        {
+            if (n > (int16_t)sizeof(reply))
+                n = sizeof(reply);
+            if (network_read_nb(sessionSpec, reply, n) != n)
+                return apiCallEnd(API_CALL_ERROR);
+
+            switch (sessionScanHeader((uint8_t)n))
+            {
+            case HEADER_DONE:
+                phase = PHASE_HEAD;
+                break;
+            case HEADER_BAD:
+                if (hdrOk && !hdrLength)
+                {
+                    // Without a length the end of the body cannot be found on the session, so
+                    // send this call again, and all later ones, by opening the url for each
+                    sessionClose();
+                    sessionNoLength = true;
+                    useSession = SESSION_NONE;
+                    return apiCallOpen();
+                }
+                return apiCallEnd(API_CALL_ERROR);
+            }
+        }
+        else if (n < 0 && sessionReused && !hdrPos && !hdrCrLf)
+        {
+            // The server dropped an idle keep-alive channel before answering. Reconnect and resend
+            sessionClose();
+            if (sessionRequest() != SESSION_OK)
+                return apiCallEnd(API_CALL_ERROR);
+            n = 0;
+        }
+        break;
+#endif
+
+    case PHASE_HEAD:
+        // Peek at the first byte. Full payloads are read straight into a state buffer, while
+        // unchanged/delta replies go to the reply buffer so the current state is kept intact
+        if ((n = apiAvailable(1, false)) > 0)
+        {
+            if (apiRead(&head, 1) != 1)
+                return apiCallEnd(API_CALL_ERROR);
+
+            if (head == RESPONSE_NOCHANGE || head == RESPONSE_DELTA)
+            {
+                dest = reply;
+                space = sizeof(reply);
+            }
+            else
+            {
+                // Into the back buffer, unless it holds what is on screen
+                receiving = frontShown ? clientStateBack : clientStateFront;
+                backState = BACK_STALE;
+                dest = receiving->payload + 1;
+                space = sizeof(clientState.payload) - 1;
+            }
+            received = 0;
+            bodyEnd = false;
+            phase = PHASE_BODY;
+        }
+        break;
+
+    case PHASE_BODY:
+        // Read the body as it arrives. The game only sees it once all of it is in, as it goes to
+        // the reply buffer or a state buffer that is not on screen
+        if ((n = apiAvailable(space, true)) > 0)
+        {
+            if ((n = apiRead(dest + received, n)) <= 0)
+                break;
+            received += n;
+            space -= n;
+        }
+
+        if (n >= 0 && (bodyEnd || !space))
+        {
+#ifdef API_TRACE
+            traceCapture(url, head, dest, received);
 #endif
+            return apiCallEnd(apiCallFinish(received));
+        }
+        break;
+    }
 
-    // If no bytes read, set first byte of clientState to 0, which is the number of tables or players
-    if (read <= 0)
+    if (n > 0)
+    {
+        idleFrames = 0;
+    }
+    else if (n < 0 || ++idleFrames > API_TIMEOUT_FRAMES)
     {
-        clientState.firstByte = 0;
+        // Drop a partly received payload, which is never the state on screen (see PHASE_HEAD),
+        // and ask for a full one next time, as the state version may no longer match it
+        if (phase == PHASE_BODY && dest != reply)
+            receiving->firstByte = 0;
+        stateVersion = 0;
+        return apiCallEnd(API_CALL_ERROR);
+    }
+
+    return API_CALL_PENDING;
+}
+
+/// @brief Returns true while an Api call is in progress
+bool apiCallBusy()
+{
+    return phase != PHASE_IDLE;
+}
+
+/// @brief Returns true if the last call started was sent as a long-poll, with "&wait="
+bool apiCallLongPoll()
+{
+    return longPoll;
+}
+
+/*
+ * @brief Starts an Api call that completes in the background while a screen waits on input
+ * Screens call apiCallIdle() every frame. Returns API_CALL_PENDING, or API_CALL_ERROR
+ */
+uint8_t apiCallBackground(const char *path)
+{
+    if (apiCallBusy())
         return API_CALL_ERROR;
+
+    longPoll = false;
+    callMoveId = 0;
+    backgroundCall = apiCallBegin(path) == API_CALL_PENDING;
+    return backgroundCall ? API_CALL_PENDING : API_CALL_ERROR;
+}
+
+/// @brief Advances a call started with apiCallBackground(), if one is in progress
+void apiCallIdle()
+{
+    if (backgroundCall && apiCallTick() != API_CALL_PENDING)
+        backgroundCall = false;
+}
+
+/*
+ * @brief Waits for any call in progress to complete, returning its API_CALL_* result, or
+ * API_CALL_ERROR if there was none. Its reply is applied as any other (see apiCallFinish)
+ */
+uint8_t apiCallComplete()
+{
+    static uint8_t result;
+
+    // A held long-poll is waited on too, as dropping it would close the keep-alive session,
+    // and polls only hold while the player cannot move
+    result = API_CALL_ERROR;
+    while (apiCallBusy())
+    {
+        waitvsync();
+        result = apiCallTick();
     }
 
-    return API_CALL_SUCCESS;
+    return result;
+}
+
+/*
+ * @brief Makes an Api call, waiting for the result
+ * Any call already in progress is completed first. Returns API_CALL_* (see apiCallTick)
+ */
+uint8_t apiCall(const char *path)
+{
+    static uint8_t result, drained;
+
+    // A move drained here stays in the outbox, and is sent again with the same id, which the
+    // server answers as a poll
+    drained = apiCallComplete();
+
+    longPoll = false;
+    callMoveId = 0;
+    result = apiCallBegin(path);
+    while (result == API_CALL_PENDING)
+    {
+        waitvsync();
+        result = apiCallTick();
+    }
+
+    // The drained reply may have changed the state, which then is not shown yet
+    if (result == API_CALL_NOCHANGE && drained == API_CALL_SUCCESS)
+        result = API_CALL_SUCCESS;
+
+    return result;
+}
+
+/// @brief Removes the oldest move from the outbox if it was acknowledged, or has failed too often
+static void outboxDone(bool acknowledged)
+{
+    static uint8_t i;
+
+    if (!acknowledged && ++outboxTries < MOVE_TRIES_MAX)
+        return;
+
+    outboxTries = 0;
+    outboxCount--;
+    for (i = 0; i < outboxCount; i++)
+    {
+        outboxId[i] = outboxId[i + 1];
+        strcpy(outbox[i], outbox[i + 1]);
+    }
 }
 
+/*
+ * @brief Queues a move for the server, or drops all unacknowledged moves if move is NULL
+ */
 void sendMove(char *move)
 {
-    if (move != NULL)
-        state.apiCallWait = 0;
+    static uint8_t i;
+
+    if (move == NULL)
+    {
+        outboxCount = 0;
+        return;
+    }
 
-    requestedMove = move;
+    // A full outbox drops its oldest move
+    if (outboxCount == OUTBOX_MAX)
+        outboxDone(true);
+
+    // Sequence numbers skip 0, which means no move
+    if (!++moveId)
+        moveId = 1;
+
+    i = outboxCount++;
+    outboxId[i] = moveId;
+    strcpy(outbox[i], move);
+
+    state.apiCallWait = 0;
+    fastPolls = POLL_AFTER_MOVE_COUNT;
+}
+
+/// @brief Returns true while a move is waiting in the outbox
+bool movePending()
+{
+    return outboxCount != 0;
 }
 
+/*
+ * @brief Returns the frames to wait before polling again, given the result of the last poll
+ */
+uint8_t nextPollWait(uint8_t update, uint8_t failedApiCalls)
+{
+    static uint8_t wait, seconds;
+
+    if (update == STATE_UPDATE_ERROR)
+        return pollPolicy[POLL_ERROR] * failedApiCalls + (pollPolicy[POLL_JITTER] ? getRandomNumber(pollPolicy[POLL_JITTER]) : 0);
+
+    // Poll again right away after a long-poll, unless the server answered without holding it
+    if (longPoll && (update == STATE_UPDATE_CHANGE || callFrames >= LONGPOLL_MIN_FRAMES))
+        return pollPolicy[POLL_LONGPOLL];
+
+    // Estimate the opponent's time left, as the clock ticking down does not change the state version
+    if (update == STATE_UPDATE_CHANGE)
+        opponentSeconds = clientState.game.moveTime;
+
+    if (fastPolls)
+    {
+        fastPolls--;
+        wait = pollPolicy[POLL_AFTER_MOVE];
+    }
+    else if (clientState.game.status == STATUS_LOBBY)
+    {
+        wait = pollPolicy[state.countdownStarted ? POLL_COUNTDOWN : POLL_DEFAULT];
+    }
+    else if (clientState.game.playerStatus == PLAYER_STATUS_VIEWING)
+    {
+        wait = pollPolicy[POLL_SPECTATOR];
+    }
+    else if (clientState.game.status >= STATUS_GAMESTART && clientState.game.activePlayer > 0 && opponentSeconds > POLL_OPPONENT_SECONDS)
+    {
+        wait = pollPolicy[POLL_OPPONENT];
+    }
+    else
+    {
+        wait = pollPolicy[POLL_DEFAULT];
+    }
+
+    seconds = wait / getJiffiesPerSecond();
+    opponentSeconds = opponentSeconds > seconds ? opponentSeconds - seconds : 0;
+    return wait;
+}
+
+/// @brief Returns true while this player may send a move or ready toggle at any moment
+static bool playerCanMove()
+{
+    if (clientState.game.playerStatus == PLAYER_STATUS_VIEWING)
+        return false;
+
+    switch (clientState.game.status)
+    {
+    case STATUS_LOBBY:
+        return true;
+    case STATUS_PLACE_SHIPS:
+        return clientState.game.playerStatus == PLAYER_STATUS_PLACE_SHIPS;
+    case STATUS_GAMEOVER:
+        return false;
+    }
+
+    return clientState.game.activePlayer == 0;
+}
+
+/*
+ * @brief Polls the server without blocking, sending any requested move first
+ * Returns STATE_UPDATE_PENDING until the poll completes
+ */
 uint8_t getStateFromServer()
 {
+    static uint8_t result;
 
-    if (requestedMove)
+    if (!apiCallBusy())
     {
-        // Copy requested move to the temp buffer it is not already one and the same
-        if (requestedMove != tempBuffer)
-            strcpy(tempBuffer, requestedMove);
+        // Reconcile the ready toggle. The server's reply to a sent toggle is final, unless the
+        // player toggled again since. Otherwise send one only if the server disagrees
+        if (state.readyPending && !outboxCount)
+        {
+            if (state.readySent || clientState.game.status != STATUS_LOBBY || state.readyWanted == (clientState.lobby.playerStatus == PLAYER_STATUS_READY))
+            {
+                // Redraw if the player is left looking at a state the server did not take
+                if (clientState.game.status == STATUS_LOBBY && state.readyWanted != (clientState.lobby.playerStatus == PLAYER_STATUS_READY))
+                    state.drawBoard = true;
+                state.readyPending = false;
+            }
+            else
+            {
+                sendMove("ready");
+                state.readySent = true;
+            }
+        }
+
+        longPoll = false;
+        if (outboxCount)
+        {
+            // Send the oldest unacknowledged move
+            callMoveId = outboxId[0];
+            strcpy(tempBuffer, outbox[0]);
+        }
+        else
+        {
+            callMoveId = 0;
+            strcpy(tempBuffer, "state");
+
+#ifndef DISABLE_KEEPALIVE
+            // Only long-poll over the keep-alive session, where waiting does not block the client,
+            // and while the player cannot move, so a move is never queued behind a held poll
+            longPoll = stateVersion && !playerCanMove() && sessionCapable();
+#endif
+        }
 
-        requestedMove = NULL;
+        if (apiCallBegin(tempBuffer) == API_CALL_ERROR)
+        {
+            if (callMoveId)
+                outboxDone(false);
+            return STATE_UPDATE_ERROR;
+        }
     }
-    else
+
+    result = apiCallTick();
+
+    // Any reply to a move means the server has it. Check it is still queued, as sendMove(NULL) may have cleared it
+    if (result != API_CALL_PENDING && callMoveId && outboxCount && outboxId[0] == callMoveId)
+        outboxDone(result != API_CALL_ERROR);
+
+    switch (result)
     {
-        strcpy(tempBuffer, "state");
+    case API_CALL_PENDING:
+        return STATE_UPDATE_PENDING;
+    case API_CALL_SUCCESS:
+        return STATE_UPDATE_CHANGE;
+    case API_CALL_NOCHANGE:
+        return STATE_UPDATE_NOCHANGE;
     }
 
-    return apiCall(tempBuffer);
+    return STATE_UPDATE_ERROR;
 }
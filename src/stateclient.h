@@ -11,14 +11,129 @@
 #define API_CALL_ERROR (0)
 #define API_CALL_SUCCESS (1)
 #define API_CALL_PENDING (2)
+#define API_CALL_NOCHANGE (3)
 
 #define STATE_UPDATE_ERROR (0)
 #define STATE_UPDATE_CHANGE (1)
 #define STATE_UPDATE_NOCHANGE (2)
+#define STATE_UPDATE_PENDING (3)
+
+/*
+ * Conditional polling (client version 3)
+ * Every bin payload ends with a trailer: [events..][event count][event seq][state version].
+ * The client echoes the state version back as "&ver=N", and if nothing changed since that
+ * version the server answers with just two bytes: RESPONSE_NOCHANGE followed by the version.
+ * A version of 0 means unknown, which always returns the full payload.
+ *
+ * There is no negotiation. A server older than version 3 ignores "v", "ver" and "bin=2"
+ * and sends unpacked payloads without a trailer. Once a full payload has the length of
+ * that and not of one with a trailer, the client sends "bin=1&v=2" without "ver" or "ev"
+ * for the rest of the run, and takes each full payload as is.
+ *
+ * Between two game payloads (status >= STATUS_PLACE_SHIPS) the server may instead
+ * answer with RESPONSE_DELTA, followed by records of [offset lo][offset hi][length][bytes..]
+ * patching the Game struct, followed by the trailer. Deltas always carry moveTime, since
+ * the client counts it down locally, and are never longer than DELTA_MAX bytes in total.
+ *
+ * Packed boards ("bin=2")
+ * Full game payloads may send each player's gamefield as 25 bytes, four cells per byte with
+ * the first cell in the low two bits, and then set TRAILER_PACKED in the event count byte.
+ * The client unpacks them into the Game struct as received. Deltas are never packed, and
+ * always patch the unpacked struct.
+ */
+#define RESPONSE_NOCHANGE 0xFF
+#define RESPONSE_DELTA 0xFE
+#define DELTA_MAX 128
+
+/*
+ * Event log
+ * The client echoes the last event seq back as "&ev=N", and the trailer lists the attacks
+ * since then, oldest first, as AttackEvent records (at most EVENT_MAX, dropping the oldest).
+ * Seqs wrap from 255 to 1. A seq of 0 means none seen yet, which returns no events, so
+ * joining never replays history.
+ * Events are queued in state.events until renderGameboard() plays them back.
+ */
+#define TRAILER_BAD 0xFFFF
+#define TRAILER_PACKED 0x80
+
+/*
+ * Double buffered state
+ * A new state is received into the back buffer, prevState, and the buffers are swapped,
+ * so the renderer compares clientState against what was on screen without copying it.
+ * processStateChange() calls stateShown() once rendered, which brings the back buffer up
+ * to date by copying the Game struct. Until then, further states are received into the
+ * front buffer, so the back buffer still holds what is on screen.
+ *
+ * Define STATE_DELTA_REPLAY in the platform's vars.h to keep the last delta (DELTA_MAX
+ * bytes) and replay it onto the back buffer instead, which is usually a few bytes rather
+ * than a copy of the Game struct. Platforms short on memory leave it out.
+ */
+void stateShown();
+
+extern uint8_t stateVersion;
+extern uint8_t eventSeq;
+
+/*
+ * Poll scheduling
+ * pollPolicy holds the frames to wait before the next poll for each context below.
+ * Errors back off by POLL_ERROR frames per consecutive failure (max 4), plus up to
+ * POLL_JITTER random frames so clients that failed together do not retry together.
+ * Keep POLL_ERROR * 4 + POLL_JITTER under 256.
+ *
+ * The lobby countdown is only seen through the prompt, so POLL_COUNTDOWN polls a few
+ * times a second, and relies on the server moving to a new state version each second
+ * of the countdown. Otherwise the polls are answered as unchanged until it ends.
+ */
+#define POLL_DEFAULT 0    // Anything not covered below
+#define POLL_COUNTDOWN 1  // Lobby countdown to game start is running
+#define POLL_AFTER_MOVE 2 // The few polls right after this player's move
+#define POLL_OPPONENT 3   // An opponent's turn with more than POLL_OPPONENT_SECONDS left
+#define POLL_SPECTATOR 4  // Viewing a game without playing
+#define POLL_ERROR 5
+#define POLL_JITTER 6
+#define POLL_LONGPOLL 7   // After a long-poll the server held until something changed
+
+#define POLL_AFTER_MOVE_COUNT 3
+#define POLL_OPPONENT_SECONDS 15
+
+extern uint8_t pollPolicy[];
+
+/*
+ * Long-poll
+ * Over the keep-alive session, state polls with a known version add "&wait=N". The server
+ * holds the reply until the state changes or N seconds pass, then answers as usual.
+ * A reply that came back sooner than LONGPOLL_MIN_FRAMES without a change means the
+ * server does not hold polls, so the regular schedule is used instead.
+ * Polls only hold while this player cannot move (waiting on others, or viewing). A held
+ * poll is never dropped, as that would close the session. Calls made meanwhile wait for it.
+ */
+#define LONGPOLL_SECONDS "8"
+#define LONGPOLL_MIN_FRAMES 30
+
+/*
+ * Move outbox
+ * sendMove() queues a move until the server acknowledges it, and queued moves are sent
+ * ahead of state polls, retrying on the error backoff. Each carries "&mid=N", a sequence
+ * number (wrapping from 255 to 1) that the server uses to apply a retried move only once,
+ * answering a repeat of the last mid it applied as it would a poll.
+ * A move that still fails after MOVE_TRIES_MAX attempts is dropped.
+ */
+#define OUTBOX_MAX 3
+#define OUTBOX_MOVE_LEN 32
+#define MOVE_TRIES_MAX 8
 
 void updateState(bool isTables);
 uint8_t getStateFromServer();
 uint8_t apiCall(const char *path );
+uint8_t apiCallComplete();
+uint8_t apiCallBegin(const char *path);
+uint8_t apiCallTick();
+bool apiCallBusy();
+bool apiCallLongPoll();
+uint8_t apiCallBackground(const char *path);
+void apiCallIdle();
 void sendMove(char* move);
+bool movePending();
+uint8_t nextPollWait(uint8_t update, uint8_t failedApiCalls);
 
 #endif /* STATECLIENT_H */
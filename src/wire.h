@@ -0,0 +1,131 @@
+/*
+ * Wire layouts of the server's binary payloads, read straight into ClientState.
+ * Generated from wire.schema by support/schema/wiregen.py. Do not edit: change the
+ * schema and run "make wire".
+ */
+
+#ifndef WIRE_H
+#define WIRE_H
+
+typedef struct
+{
+    char table[9];   //   0
+    char name[21];   //   9
+    char players[6]; //  30
+} Table;
+
+typedef struct
+{
+    char name[9];           //   0
+    uint8_t playerStatus;   //   9
+    uint8_t gamefield[100]; //  10
+    uint8_t shipsLeft[5];   // 110
+} Player;
+
+typedef struct
+{
+    char name[9];  //   0
+    uint8_t ready; //   9
+} LobbyPlayer;
+
+// A page of the table list
+typedef struct
+{
+    uint8_t count;           //   0 Tables in this page
+    uint8_t total;           //   1 Tables on the server
+    uint8_t first;           //   2 Index of table[0] in the list
+    Table table[TABLE_PAGE]; //   3
+} Tables;
+
+typedef struct
+{
+    uint8_t playerCount;        //   0
+    char prompt[33];            //   1
+    uint8_t status;             //  34
+    uint8_t playerStatus;       //  35
+    int8_t activePlayer;        //  36
+    uint8_t moveTime;           //  37
+    uint8_t lastAttackPos;      //  38
+    // First 5 are my ships, last 5 are winner, sent at game over
+    uint8_t myShips[10];        //  39
+    Player players[PLAYER_MAX]; //  49
+} Game;
+
+// An attack from the server's event log (see stateclient.h)
+typedef struct
+{
+    uint8_t pos;      //   0
+    uint8_t attacker; //   1 Player index, in this client's player order
+    uint8_t status;   //   2 STATUS_MISS, STATUS_HIT or STATUS_SUNK
+} AttackEvent;
+
+typedef struct
+{
+    uint8_t playerCount;             //   0
+    char prompt[33];                 //   1
+    uint8_t status;                  //  34
+    uint8_t playerStatus;            //  35
+    int8_t activePlayer;             //  36
+    uint8_t moveTime;                //  37
+    char serverName[21];             //  38
+    LobbyPlayer players[PLAYER_MAX]; //  59
+} Lobby;
+
+// Layout checks. A check that fails declares an array of negative size
+// Targets without <stddef.h> in standard_lib.h take offsets the way cc65's offsetof() does
+#ifdef offsetof
+#define WIRE_OFFSET(type, field) offsetof(type, field)
+#else
+#define WIRE_OFFSET(type, field) ((unsigned int)&((type *)0)->field)
+#endif
+#if PLAYER_MAX != 4
+#error PLAYER_MAX does not match wire.schema
+#endif
+#if EVENT_MAX != 8
+#error EVENT_MAX does not match wire.schema
+#endif
+#if TABLE_PAGE != 10
+#error TABLE_PAGE does not match wire.schema
+#endif
+typedef char wireSizeTable[sizeof(Table) == 36 ? 1 : -1];
+typedef char wireOffsetTable_table[WIRE_OFFSET(Table, table) == 0 ? 1 : -1];
+typedef char wireOffsetTable_name[WIRE_OFFSET(Table, name) == 9 ? 1 : -1];
+typedef char wireOffsetTable_players[WIRE_OFFSET(Table, players) == 30 ? 1 : -1];
+typedef char wireSizePlayer[sizeof(Player) == 115 ? 1 : -1];
+typedef char wireOffsetPlayer_name[WIRE_OFFSET(Player, name) == 0 ? 1 : -1];
+typedef char wireOffsetPlayer_playerStatus[WIRE_OFFSET(Player, playerStatus) == 9 ? 1 : -1];
+typedef char wireOffsetPlayer_gamefield[WIRE_OFFSET(Player, gamefield) == 10 ? 1 : -1];
+typedef char wireOffsetPlayer_shipsLeft[WIRE_OFFSET(Player, shipsLeft) == 110 ? 1 : -1];
+typedef char wireSizeLobbyPlayer[sizeof(LobbyPlayer) == 10 ? 1 : -1];
+typedef char wireOffsetLobbyPlayer_name[WIRE_OFFSET(LobbyPlayer, name) == 0 ? 1 : -1];
+typedef char wireOffsetLobbyPlayer_ready[WIRE_OFFSET(LobbyPlayer, ready) == 9 ? 1 : -1];
+typedef char wireSizeTables[sizeof(Tables) == 363 ? 1 : -1];
+typedef char wireOffsetTables_count[WIRE_OFFSET(Tables, count) == 0 ? 1 : -1];
+typedef char wireOffsetTables_total[WIRE_OFFSET(Tables, total) == 1 ? 1 : -1];
+typedef char wireOffsetTables_first[WIRE_OFFSET(Tables, first) == 2 ? 1 : -1];
+typedef char wireOffsetTables_table[WIRE_OFFSET(Tables, table) == 3 ? 1 : -1];
+typedef char wireSizeGame[sizeof(Game) == 509 ? 1 : -1];
+typedef char wireOffsetGame_playerCount[WIRE_OFFSET(Game, playerCount) == 0 ? 1 : -1];
+typedef char wireOffsetGame_prompt[WIRE_OFFSET(Game, prompt) == 1 ? 1 : -1];
+typedef char wireOffsetGame_status[WIRE_OFFSET(Game, status) == 34 ? 1 : -1];
+typedef char wireOffsetGame_playerStatus[WIRE_OFFSET(Game, playerStatus) == 35 ? 1 : -1];
+typedef char wireOffsetGame_activePlayer[WIRE_OFFSET(Game, activePlayer) == 36 ? 1 : -1];
+typedef char wireOffsetGame_moveTime[WIRE_OFFSET(Game, moveTime) == 37 ? 1 : -1];
+typedef char wireOffsetGame_lastAttackPos[WIRE_OFFSET(Game, lastAttackPos) == 38 ? 1 : -1];
+typedef char wireOffsetGame_myShips[WIRE_OFFSET(Game, myShips) == 39 ? 1 : -1];
+typedef char wireOffsetGame_players[WIRE_OFFSET(Game, players) == 49 ? 1 : -1];
+typedef char wireSizeAttackEvent[sizeof(AttackEvent) == 3 ? 1 : -1];
+typedef char wireOffsetAttackEvent_pos[WIRE_OFFSET(AttackEvent, pos) == 0 ? 1 : -1];
+typedef char wireOffsetAttackEvent_attacker[WIRE_OFFSET(AttackEvent, attacker) == 1 ? 1 : -1];
+typedef char wireOffsetAttackEvent_status[WIRE_OFFSET(AttackEvent, status) == 2 ? 1 : -1];
+typedef char wireSizeLobby[sizeof(Lobby) == 99 ? 1 : -1];
+typedef char wireOffsetLobby_playerCount[WIRE_OFFSET(Lobby, playerCount) == 0 ? 1 : -1];
+typedef char wireOffsetLobby_prompt[WIRE_OFFSET(Lobby, prompt) == 1 ? 1 : -1];
+typedef char wireOffsetLobby_status[WIRE_OFFSET(Lobby, status) == 34 ? 1 : -1];
+typedef char wireOffsetLobby_playerStatus[WIRE_OFFSET(Lobby, playerStatus) == 35 ? 1 : -1];
+typedef char wireOffsetLobby_activePlayer[WIRE_OFFSET(Lobby, activePlayer) == 36 ? 1 : -1];
+typedef char wireOffsetLobby_moveTime[WIRE_OFFSET(Lobby, moveTime) == 37 ? 1 : -1];
+typedef char wireOffsetLobby_serverName[WIRE_OFFSET(Lobby, serverName) == 38 ? 1 : -1];
+typedef char wireOffsetLobby_players[WIRE_OFFSET(Lobby, players) == 59 ? 1 : -1];
+
+#endif /* WIRE_H */
@@ -1,13 +1,71 @@
-import time
+import ctypes
+import ctypes.util
 import os
+import select
+import sys
+import time
 import requests  # pip install requests
 
 
-# To test in Vice, point drive 11 to the following directory:
+# To test in Vice, point drive 11 to the following directory (or pass it as the first argument):
 # Then run: make c64 VICE=1
 # The app will then save/read appkeys from this folder and call this bridge for network access
 workingPath = "/Users/eric/Documents/projects/vice-device"
 
+# Handshake with custom_network_open() in src/c64/emulator.c:
+#  1. The C64 deletes vice-in, then writes the url to vice-out, ending with a CR
+#  2. The bridge fetches the url, puts the response in vice-in and deletes vice-out
+#  3. The C64, checking every frame, sees vice-out is gone and reads vice-in
+# The bridge sleeps on filesystem notifications (inotify on Linux, kqueue on macOS),
+# so it picks up a command as soon as the C64 closes the file.
+
+POLL_SECONDS = 0.005     # Fallback where there are no notifications
+COMMAND_SETTLE = 0.002   # Recheck interval while a command is still being written
+COMMAND_WAIT_MAX = 0.5   # Give up on a command that never gets its CR
+
+
+class InotifyWatcher:
+    """Wakes on files closed after writing, or moved into the directory (Linux)"""
+    IN_CLOSE_WRITE = 0x008
+    IN_MOVED_TO = 0x080
+
+    def __init__(self, path):
+        libc = ctypes.CDLL(ctypes.util.find_library("c"), use_errno=True)
+        self.fd = libc.inotify_init1(os.O_CLOEXEC)
+        if self.fd < 0 or libc.inotify_add_watch(self.fd, path.encode(), self.IN_CLOSE_WRITE | self.IN_MOVED_TO) < 0:
+            raise OSError(ctypes.get_errno(), "inotify")
+
+    def wait(self, timeout):
+        if select.select([self.fd], [], [], timeout)[0]:
+            os.read(self.fd, 4096)
+
+
+class KqueueWatcher:
+    """Wakes on entries added to or removed from the directory (macOS, BSD)"""
+
+    def __init__(self, path):
+        self.dirfd = os.open(path, os.O_RDONLY)
+        self.kq = select.kqueue()
+        self.event = select.kevent(self.dirfd, filter=select.KQ_FILTER_VNODE,
+                                   flags=select.KQ_EV_ADD | select.KQ_EV_CLEAR, fflags=select.KQ_NOTE_WRITE)
+
+    def wait(self, timeout):
+        self.kq.control([self.event], 1, timeout)
+
+
+class PollWatcher:
+    def wait(self, timeout):
+        time.sleep(POLL_SECONDS)
+
+
+def make_watcher(path):
+    for watcher in (InotifyWatcher, KqueueWatcher):
+        try:
+            return watcher(path)
+        except (AttributeError, OSError):
+            pass
+    return PollWatcher()
+
 
 def download_url_as_bytes(url):
     """
@@ -20,77 +78,104 @@ def download_url_as_bytes(url):
     except requests.exceptions.RequestException as e:
         print(f"Error downloading URL: {e}")
         return bytes()
-        
-def processWatchFile():
+
+
+def readWatchFile():
     """
-    Read the command of the watch file and send it as a message via the meshtastic interface.
+    Returns (command, seconds since the C64 wrote it) once the C64 has written all of the
+    watch file, or (None, 0) if there is no command.
     """
+    deadline = time.monotonic() + COMMAND_WAIT_MAX
+    while time.monotonic() < deadline:
+        try:
+            with open(watchFile, "rb") as file:
+                data = file.read()
+                written = os.fstat(file.fileno()).st_mtime
+        except FileNotFoundError:
+            return None, 0
+
+        if data.endswith(b"\r"):
+            return data[:-1].decode("ascii", "replace").strip().lower(), max(time.time() - written, 0)
+
+        # Kqueue wakes when the file is created, before the C64 has finished writing it
+        time.sleep(COMMAND_SETTLE)
 
-    with open(watchFile, "r", encoding="utf-8") as file:
-        command = file.read().strip().lower()
-        if command.startswith("n:"):
-            command = command[2:]  # remove first two characters ("n:")
-        print(f"Sending: {command}")
+    return None, 0
+
+
+def processWatchFile(command):
+    """
+    Fetch the url in the command and hand the response to the C64.
+    """
+    if command.startswith("n:"):
+        command = command[2:]  # remove first two characters ("n:")
+    print(f"Sending: {command}")
 
-        if os.path.exists(outFile):
-            os.remove(outFile)
+    started = time.monotonic()
+    payload = download_url_as_bytes(command)
+    fetched = time.monotonic()
+    print(f"Received {len(payload)} bytes:")
+    hexdump(payload)
 
-        payload = download_url_as_bytes(command) 
-        print(f"Received {len(payload)} bytes:")
-        #time.sleep(0.200)  #  simulate delay
-        hexdump(payload)
+    # Write the response under another name first, so vice-in only ever appears complete
+    with open(tempFile, "wb") as file:
+        file.write(payload)
+    os.replace(tempFile, outFile)
 
-        with open(outFile, "wb") as file:
-            file.write(payload)
+    if os.path.exists(watchFile):
+        os.remove(watchFile)
+
+    return fetched - started, time.monotonic() - started
 
-        if os.path.exists(watchFile):
-            os.remove(watchFile)
 
 def hexdump(data: bytes, width: int = 16):
     for i in range(0, len(data), width):
         chunk = data[i:i+width]
-        
+
         # Hex view
         hex_bytes = " ".join(f"{b:02x}" for b in chunk)
-        
+
         # Pad hex output to align text view
         hex_bytes = hex_bytes.ljust(width * 3)
-        
+
         # Text view (printable ASCII, else '.')
         text = "".join(chr(b) if 32 <= b < 127 else "." for b in chunk)
-        
+
         print(f"{i:08x}  {hex_bytes}  {text}")
 
+
+if len(sys.argv) > 1:
+    workingPath = sys.argv[1]
+
 print("Mock FujiNet Network Bridge")
 print("-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-")
 
 watchFile = workingPath + "/vice-out"
 outFile = workingPath + "/vice-in"
+tempFile = workingPath + "/vice-in.tmp"
 
-prevWatchFileCtime = 0
-waitMinAmount = 0.050
-waitMaxAmount = 0.200
-waitAmount = waitMinAmount
+watcher = make_watcher(workingPath)
+print(f"Watching: {watchFile} ({type(watcher).__name__})")
 
-print(f"Watching: {watchFile}")
+calls = 0
+totalSeen = totalBridge = 0.0
 
 try:
     while True:
-        if os.path.exists(watchFile) and os.path.getsize(watchFile) > 0 and os.path.getctime(watchFile) != prevWatchFileCtime:
-            try:
-                with open(watchFile, 'a') as f:
-                    writable = f.writable()
-                if writable:
-                    prevWatchFileCtime = os.path.getctime(watchFile)
-                    waitAmount=waitMinAmount
-                    processWatchFile()
-                else:
-                    waitAmount = min(waitAmount + waitMinAmount, waitMaxAmount) 
-            except IOError:
-                time.sleep(waitMinAmount)
-           
-
-        time.sleep(waitMinAmount)  #  waitMinAmount
+        command, seen = readWatchFile()
+        if command is None:
+            watcher.wait(1.0)
+            continue
+
+        fetch, bridge = processWatchFile(command)
+
+        # Round trip on the host: from the C64 closing the command file to the response being ready.
+        # The C64 adds up to a frame on top, until its next check
+        calls += 1
+        totalSeen += seen
+        totalBridge += bridge
+        print(f"Round trip {(seen + bridge) * 1000:.1f} ms: seen after {seen * 1000:.1f} ms, "
+              f"fetch {fetch * 1000:.1f} ms, bridge {bridge * 1000:.1f} ms. "
+              f"Average over {calls}: {(totalSeen + totalBridge) * 1000 / calls:.1f} ms")
 except KeyboardInterrupt:
     print("Exiting")
-iface.close()
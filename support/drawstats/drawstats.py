@@ -0,0 +1,92 @@
+"""
+Prints the draw stats a DRAW_STATS build dumped to its appkeys (see src/drawstats.h).
+
+Usage: python3 drawstats.py appkeys [baseline]
+  appkeys   Directory of appkey files, e.g. the Linux build's FBS_APPKEYS
+  baseline  Another build's appkeys, to print its counts alongside and the change
+
+Entries with no calls in either build are left out. The entry, screen, record and
+key numbering is read from src/drawstats.h and src/misc.h, so it follows the build.
+Only the Python standard library is used.
+"""
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+CREATOR_ID = 0xE41C
+APP_ID = 5
+
+
+def defines(path, prefix):
+    """Returns {name: value} for the numeric defines in path starting with prefix"""
+    found = {}
+    with open(os.path.join(ROOT, path)) as f:
+        for line in f:
+            m = re.match(r"#define (%s\w+) (\d+)" % prefix, line)
+            if m:
+                found[m.group(1)] = int(m.group(2))
+    return found
+
+
+def layout():
+    """Returns (screen names, entry names, first key, keys, record size, records per key)"""
+    header = defines("src/drawstats.h", "D")
+    screens = ["OTHER", "LOBBY", "PLACEMENT", "GAMEBOARD", "MENU"]
+    screens.sort(key=lambda s: header["DRAW_STATS_" + s])
+    entries = sorted((v, k[3:]) for k, v in header.items() if k.startswith("DS_"))
+    record, per_key = header["DRAW_STATS_RECORD"], header["DRAW_STATS_PER_KEY"]
+    keys = (len(screens) * len(entries) + per_key - 1) // per_key
+    first = defines("src/misc.h", "AK_KEY_")["AK_KEY_DRAW_STATS"]
+    return [s.lower() for s in screens], [e[1].lower() for e in entries], first, keys, record, per_key
+
+
+def load(directory):
+    """Returns {(screen, entry): (calls, cells, jiffies)}"""
+    _, entries, first, keys, record, per_key = layout()
+    stats = {}
+    for k in range(keys):
+        name = "%04x%02x%02x.key" % (CREATOR_ID, APP_ID, first + k)
+        try:
+            with open(os.path.join(directory, name), "rb") as f:
+                data = f.read()
+        except FileNotFoundError:
+            break
+        for i in range(0, len(data) - record + 1, record):
+            values = tuple(int.from_bytes(data[i + j:i + j + 2], "little") for j in (1, 3, 5))
+            stats[divmod(data[i], len(entries))] = values
+        # A key that is not full is the last
+        if len(data) < record * per_key:
+            break
+    return stats
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print(__doc__.strip())
+        sys.exit(1)
+
+    screens, entries, _, _, _, _ = layout()
+    stats = load(sys.argv[1])
+    base = load(sys.argv[2]) if len(sys.argv) == 3 else None
+
+    for s, screen in enumerate(screens):
+        rows = []
+        for e, entry in enumerate(entries):
+            now = stats.get((s, e), (0, 0, 0))
+            before = base.get((s, e), (0, 0, 0)) if base is not None else None
+            if not now[0] and not (before and before[0]):
+                continue
+            row = "  %-22s %7d %7d %7d" % ((entry,) + now)
+            if before is not None:
+                row += "  |%7d %7d %7d  | %+7d calls" % (before + (now[0] - before[0],))
+            rows.append(row)
+        if rows:
+            print("%s%s" % (screen, "" if base is None else "  (this build | baseline)"))
+            print("  %-22s %7s %7s %7s" % ("", "calls", "cells", "jiffies"))
+            print("\n".join(rows))
+
+
+if __name__ == "__main__":
+    main()
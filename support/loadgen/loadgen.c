@@ -0,0 +1,507 @@
+/*
+  Load generator for the Fuji Battleship server
+
+  Runs many simulated players at once, each a separate process built from the
+  client's own stateclient.c and the Linux network shim, so requests, long-polls,
+  the move outbox and the poll cadence are exactly what a real client sends.
+  Players ready up, place ships with the client's encoding and attack at random,
+  then the run reports the request rate and p50/p99 latency per endpoint.
+
+  Build:  make loadgen
+  Run:    r2r/linux/fbs-loadgen [-c clients] [-p players per table] [-d seconds]
+                                [-t table prefix] [-s seed] [-w think frames] [url]
+
+  Defaults are 20 clients, 2 per table, for 30 seconds, waiting 30 frames before
+  each attack. Clients fill tables <prefix>1, <prefix>2, ... in turn, and the
+  default prefix "load" matches the tables the reference server adds with
+  --load-tables:
+    python3 support/server/battleship_server.py --quiet --load-tables 100
+    r2r/linux/fbs-loadgen -c 200 -d 60 http://127.0.0.1:8080/
+
+  Latency runs from sending a request to having the whole reply. State polls the
+  server held as long-polls are counted apart, as their time is mostly the hold.
+*/
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include "../../src/misc.h"
+#include "../../src/stateclient.h"
+#include "../../src/fujinet-network.h"
+
+// unistd.h declares a pause() that clashes with the one in sound.h
+#define pause posix_pause
+#include <unistd.h>
+#undef pause
+
+#define ENDPOINT_STATE 0
+#define ENDPOINT_HELD 1 // State poll sent as a long-poll
+#define ENDPOINT_READY 2
+#define ENDPOINT_PLACE 3
+#define ENDPOINT_ATTACK 4
+#define ENDPOINT_LEAVE 5
+#define ENDPOINT_COUNT 6
+
+static const char *endpointNames[ENDPOINT_COUNT] = {"state", "state (held)", "ready", "place", "attack", "leave"};
+
+// One per request, written by a client to the shared pipe. Small enough to be written atomically
+typedef struct
+{
+    uint8_t endpoint;
+    uint8_t ok;
+    uint16_t pad;
+    uint32_t micros;
+} Sample;
+
+// Globals the client code expects (see main.c)
+char serverEndpoint[50] = "http://127.0.0.1:8080/";
+char query[50];
+char tempBuffer[128];
+GameState state;
+
+uint16_t jiffies;
+
+// In src/linux/network.c
+void networkWait(int ms);
+
+static const uint8_t shipSizes[5] = {5, 4, 3, 3, 2};
+
+static int results;
+static volatile sig_atomic_t stopping;
+static struct timespec nextFrame;
+
+static uint32_t microsSince(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+static long msUntil(const struct timespec *t)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (t->tv_sec - now.tv_sec) * 1000L + (t->tv_nsec - now.tv_nsec) / 1000000L;
+}
+
+/*
+ * Frame pacing for the client code, at 60Hz like the real thing. While a call is out, the
+ * client is ticked as soon as more of the reply arrives, and then every millisecond while it
+ * works through the reply a step at a time, so latency is measured to the millisecond rather
+ * than to the frame. runClient() clears fn_bytes_read as each call starts.
+ */
+void waitvsync()
+{
+    long ms = msUntil(&nextFrame);
+
+    if (ms > 0)
+    {
+        if (!apiCallBusy())
+        {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextFrame, NULL);
+        }
+        else
+        {
+            if (fn_bytes_read)
+                usleep(1000);
+            else
+                networkWait((int)ms);
+
+            if (msUntil(&nextFrame) > 0)
+                return;
+        }
+    }
+
+    jiffies++;
+    nextFrame.tv_nsec += 1000000000L / 60;
+    if (nextFrame.tv_nsec >= 1000000000L)
+    {
+        nextFrame.tv_nsec -= 1000000000L;
+        nextFrame.tv_sec++;
+    }
+}
+
+uint8_t getJiffiesPerSecond()
+{
+    return 60;
+}
+
+uint8_t getRandomNumber(uint8_t maxExclusive)
+{
+    return maxExclusive ? (uint8_t)(rand() % maxExclusive) : 0;
+}
+
+char *itoa(int value, char *s, int radix)
+{
+    (void)radix;
+    sprintf(s, "%d", value);
+    return s;
+}
+
+/// @brief Same test as testShip() in gamelogic.c, against the cells marked in used
+static bool testShip(const uint8_t *used, uint8_t size, uint8_t pos)
+{
+    uint8_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (used[pos % 100] || pos > 199 || (i > 0 && pos <= 100 && pos % 10 == 0))
+            return false;
+
+        pos += (pos >= 100) ? 10 : 1;
+    }
+    return true;
+}
+
+/// @brief Queues a random placement, encoded as handleShipPlacement() does
+static void placeShips()
+{
+    uint8_t used[100], i, j, pos;
+    char move[OUTBOX_MOVE_LEN];
+
+    memset(used, 0, sizeof(used));
+    strcpy(move, "place/");
+    for (i = 0; i < 5; i++)
+    {
+        while (!testShip(used, shipSizes[i], pos = getRandomNumber(200)))
+            ;
+
+        sprintf(move + strlen(move), i ? ",%d" : "%d", pos);
+        for (j = 0; j < shipSizes[i]; j++)
+        {
+            used[pos % 100] = 1;
+            pos += (pos >= 100) ? 10 : 1;
+        }
+    }
+
+    sendMove(move);
+}
+
+/// @brief Queues an attack on a random cell that some opponent still has open
+static bool attack()
+{
+    uint8_t i, pos, tries;
+    char move[16];
+
+    for (tries = 0; tries < 200; tries++)
+    {
+        pos = getRandomNumber(100);
+        for (i = 1; i < clientState.game.playerCount; i++)
+        {
+            if (clientState.game.players[i].playerStatus == PLAYER_STATUS_DEFAULT && !clientState.game.players[i].gamefield[pos])
+            {
+                sprintf(move, "attack/%d", pos);
+                sendMove(move);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void onTerm(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+static void record(uint8_t endpoint, bool ok, uint32_t micros)
+{
+    Sample s;
+
+    s.endpoint = endpoint;
+    s.ok = ok;
+    s.pad = 0;
+    s.micros = micros;
+    if (write(results, &s, sizeof(s)) < 0)
+        stopping = 1;
+}
+
+/// @brief Returns the endpoint of the call getStateFromServer() just started, from the path it copied to tempBuffer
+static uint8_t callEndpoint()
+{
+    if (!strncmp(tempBuffer, "ready", 5))
+        return ENDPOINT_READY;
+    if (!strncmp(tempBuffer, "place/", 6))
+        return ENDPOINT_PLACE;
+    if (!strncmp(tempBuffer, "attack/", 7))
+        return ENDPOINT_ATTACK;
+    if (apiCallLongPoll())
+        return ENDPOINT_HELD;
+    return ENDPOINT_STATE;
+}
+
+/// @brief One simulated player. Mirrors the poll loop in main() and the moves a player makes
+static void runClient(const char *table, const char *player, uint8_t thinkFrames)
+{
+    static struct timespec callStart;
+    uint8_t update, failedApiCalls = 0, endpoint = 0, think = 0;
+    bool busy = false, placed = false;
+
+    signal(SIGTERM, onTerm);
+    clock_gettime(CLOCK_MONOTONIC, &nextFrame);
+
+    snprintf(query, sizeof(query), "?table=%s&player=%s", table, player);
+    state.apiCallWait = 0;
+
+    while (!stopping)
+    {
+        if (apiCallBusy() || !state.apiCallWait--)
+        {
+            if (!busy)
+            {
+                clock_gettime(CLOCK_MONOTONIC, &callStart);
+                fn_bytes_read = 0;
+            }
+
+            update = getStateFromServer();
+            if (!busy)
+                endpoint = callEndpoint();
+            busy = update == STATE_UPDATE_PENDING;
+
+            if (update != STATE_UPDATE_PENDING)
+            {
+                record(endpoint, update != STATE_UPDATE_ERROR, microsSince(&callStart));
+
+                if (update == STATE_UPDATE_ERROR)
+                {
+                    if (failedApiCalls < 4)
+                        failedApiCalls++;
+                }
+                else
+                {
+                    failedApiCalls = 0;
+
+                    // As processStateChange() does once rendered, so deltas go through the back buffer
+                    if (update == STATE_UPDATE_CHANGE)
+                        stateShown();
+                }
+                state.apiCallWait = nextPollWait(update, failedApiCalls);
+            }
+        }
+
+        // React to the state like a player would, once any move already made has gone out.
+        // Polls are not held while the player can move, so a move waits on a regular poll at most
+        if (!movePending() && !state.readyPending)
+        {
+            if (clientState.game.status == STATUS_LOBBY)
+            {
+                placed = false;
+                if (clientState.lobby.playerStatus != PLAYER_STATUS_READY)
+                {
+                    // As processInput() toggles ready
+                    state.readyWanted = true;
+                    state.readyPending = true;
+                    state.readySent = false;
+                    state.apiCallWait = 0;
+                }
+            }
+            else if (clientState.game.status == STATUS_PLACE_SHIPS)
+            {
+                if (!placed && clientState.game.playerStatus == PLAYER_STATUS_PLACE_SHIPS)
+                {
+                    placeShips();
+                    placed = true;
+                }
+            }
+            else if (clientState.game.status >= STATUS_GAMESTART && clientState.game.status != STATUS_GAMEOVER &&
+                     clientState.game.activePlayer == 0 && clientState.game.playerStatus == PLAYER_STATUS_DEFAULT)
+            {
+                if (think++ >= thinkFrames)
+                {
+                    think = 0;
+                    attack();
+                }
+            }
+        }
+
+        waitvsync();
+    }
+
+    // Free the seat for the next run
+    clock_gettime(CLOCK_MONOTONIC, &callStart);
+    fn_bytes_read = 0;
+    apiCall("leave");
+
+    // The reply has no body, which the client takes as an error, so only the time is of use
+    record(ENDPOINT_LEAVE, true, microsSince(&callStart));
+}
+
+static int compareMicros(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(uint32_t **micros, uint32_t *counts, uint32_t *errors, double seconds)
+{
+    uint8_t e;
+    uint32_t n, total = 0, totalErrors = 0;
+
+    printf("%-14s %9s %9s %7s %9s %9s\n", "endpoint", "requests", "req/s", "errors", "p50 ms", "p99 ms");
+    for (e = 0; e < ENDPOINT_COUNT; e++)
+    {
+        n = counts[e];
+        if (!n)
+            continue;
+
+        qsort(micros[e], n, sizeof(uint32_t), compareMicros);
+        printf("%-14s %9u %9.1f %7u %9.2f %9.2f\n", endpointNames[e], n, n / seconds, errors[e],
+               micros[e][(n - 1) / 2] / 1000.0, micros[e][(n * 99 - 1) / 100] / 1000.0);
+        total += n;
+        totalErrors += errors[e];
+    }
+    printf("%-14s %9u %9.1f %7u\n", "total", total, total / seconds, totalErrors);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c clients] [-p players per table] [-d seconds] [-t table prefix] [-s seed] [-w think frames] [url]\n", name);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int clients = 20, perTable = 2, seconds = 30, seed = 1, think = 30, opt, fds[2], i, live;
+    const char *prefix = "load";
+    char table[21], player[9]; // A prefix of up to 16 with the table number, and a name as the server keeps it
+    pid_t *pids;
+    uint32_t *micros[ENDPOINT_COUNT], counts[ENDPOINT_COUNT], sizes[ENDPOINT_COUNT], errors[ENDPOINT_COUNT];
+    struct timespec start;
+    struct pollfd pfd;
+    Sample batch[256];
+    ssize_t got;
+    uint8_t e;
+
+    while ((opt = getopt(argc, argv, "c:p:d:t:s:w:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            clients = atoi(optarg);
+            break;
+        case 'p':
+            perTable = atoi(optarg);
+            break;
+        case 'd':
+            seconds = atoi(optarg);
+            break;
+        case 't':
+            prefix = optarg;
+            break;
+        case 's':
+            seed = atoi(optarg);
+            break;
+        case 'w':
+            think = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (optind < argc)
+    {
+        if (strlen(argv[optind]) >= sizeof(serverEndpoint))
+            usage(argv[0]);
+        strcpy(serverEndpoint, argv[optind]);
+    }
+
+    if (clients < 1 || clients > 9999 || perTable < 1 || perTable > PLAYER_MAX || seconds < 1 || think < 0 || think > 255 || strlen(prefix) > 16)
+        usage(argv[0]);
+
+    if (pipe(fds))
+    {
+        perror("pipe");
+        return 1;
+    }
+
+    printf("%d clients on %d tables (%s1..) at %s for %ds\n", clients, (clients + perTable - 1) / perTable, prefix, serverEndpoint, seconds);
+    fflush(stdout);
+
+    pids = calloc(clients, sizeof(pid_t));
+    for (i = 0; i < clients; i++)
+    {
+        if ((pids[i] = fork()) == 0)
+        {
+            close(fds[0]);
+            results = fds[1];
+            srand(seed * 7919 + i);
+            snprintf(table, sizeof(table), "%s%d", prefix, i / perTable + 1);
+            snprintf(player, sizeof(player), "lg%d", i);
+            runClient(table, player, (uint8_t)think);
+            _exit(0);
+        }
+        if (pids[i] < 0)
+        {
+            perror("fork");
+            clients = i;
+            break;
+        }
+    }
+    close(fds[1]);
+
+    memset(counts, 0, sizeof(counts));
+    memset(errors, 0, sizeof(errors));
+    for (e = 0; e < ENDPOINT_COUNT; e++)
+    {
+        sizes[e] = 1024;
+        micros[e] = malloc(sizes[e] * sizeof(uint32_t));
+    }
+
+    // Collect samples until the run is over, then stop the clients and collect the rest
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pfd.fd = fds[0];
+    pfd.events = POLLIN;
+    live = 1;
+    while (true)
+    {
+        if (live && microsSince(&start) >= (uint32_t)seconds * 1000000U)
+        {
+            for (i = 0; i < clients; i++)
+                kill(pids[i], SIGTERM);
+            live = 0;
+        }
+
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        if ((got = read(fds[0], batch, sizeof(batch))) <= 0)
+        {
+            if (got < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (i = 0; i < got / (ssize_t)sizeof(Sample); i++)
+        {
+            e = batch[i].endpoint;
+            if (e >= ENDPOINT_COUNT)
+                continue;
+
+            // The final leave is not part of the timed run
+            if (!live && e != ENDPOINT_LEAVE)
+                continue;
+
+            if (counts[e] == sizes[e])
+            {
+                sizes[e] *= 2;
+                micros[e] = realloc(micros[e], sizes[e] * sizeof(uint32_t));
+            }
+            micros[e][counts[e]++] = batch[i].micros;
+            if (!batch[i].ok)
+                errors[e]++;
+        }
+    }
+
+    while (wait(NULL) > 0)
+        ;
+
+    report(micros, counts, errors, seconds);
+    return 0;
+}
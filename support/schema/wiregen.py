@@ -0,0 +1,166 @@
+"""
+Generates src/wire.h from src/wire.schema, the wire layouts of the server's binary payloads.
+
+Usage: python3 wiregen.py [--check] [schema] [header]
+  --check   Exit with an error if the header is not up to date, instead of writing it
+
+The header holds the structs, with each field's offset alongside, and a size check
+per struct and an offset check per field. All of cc65, cmoc, Open Watcom and the host
+compiler must agree on the layout, so a check that fails declares an array of negative
+size and stops the build.
+Only the Python standard library is used.
+"""
+
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+BYTE_TYPES = ("char", "int8_t", "uint8_t")
+
+FIELD = re.compile(r"^(\w+)\s+(\w+)(?:\[(\w+)\])?\s*(//.*)?$")
+
+
+class SchemaError(Exception):
+    pass
+
+
+def parse(text):
+    """Returns (constants, structs), with structs a list of (name, comments, fields)"""
+    constants, structs = {}, []
+    comments = []
+    struct = None
+
+    for number, raw in enumerate(text.splitlines(), 1):
+        line = raw.strip()
+        if not line or line.startswith("#"):
+            continue
+
+        try:
+            if line.startswith("//"):
+                comments.append(line)
+            elif line.startswith("const "):
+                _, name, value = line.split()
+                constants[name] = int(value)
+                struct = None
+            elif line.startswith("struct "):
+                struct = (line.split()[1], comments, [])
+                structs.append(struct)
+                comments = []
+            elif struct and raw[:1].isspace():
+                match = FIELD.match(line)
+                if not match:
+                    raise SchemaError("expected: type name[count] // comment")
+                ftype, name, count, comment = match.groups()
+                struct[2].append((ftype, name, count, comment, comments))
+                comments = []
+            else:
+                raise SchemaError("expected const, struct or an indented field")
+        except (SchemaError, ValueError) as e:
+            raise SchemaError("wire.schema:%d: %s" % (number, e))
+
+    return constants, structs
+
+
+def layout(constants, structs):
+    """Returns {struct name: (size, [field offsets])}, checking every field type and count"""
+    sizes = dict((t, 1) for t in BYTE_TYPES)
+    result = {}
+
+    for name, _, fields in structs:
+        offset, offsets = 0, []
+        for ftype, fname, count, _, _ in fields:
+            if ftype not in sizes:
+                raise SchemaError("%s.%s: %s is not a byte type or an earlier struct. Wider integers would "
+                                  "depend on each CPU's byte order" % (name, fname, ftype))
+            if count is None:
+                n = 1
+            elif count.isdigit():
+                n = int(count)
+            elif count in constants:
+                n = constants[count]
+            else:
+                raise SchemaError("%s.%s: unknown count %s" % (name, fname, count))
+            offsets.append(offset)
+            offset += sizes[ftype] * n
+
+        sizes[name] = offset
+        result[name] = (offset, offsets)
+
+    return result
+
+
+def generate(constants, structs):
+    sizes = layout(constants, structs)
+    out = [
+        "/*",
+        " * Wire layouts of the server's binary payloads, read straight into ClientState.",
+        " * Generated from wire.schema by support/schema/wiregen.py. Do not edit: change the",
+        " * schema and run \"make wire\".",
+        " */",
+        "",
+        "#ifndef WIRE_H",
+        "#define WIRE_H",
+        "",
+    ]
+
+    for name, comments, fields in structs:
+        out += comments
+        out.append("typedef struct")
+        out.append("{")
+        decls = []
+        for ftype, fname, count, comment, fcomments in fields:
+            decls.append((fcomments, "    %s %s%s;" % (ftype, fname, "[%s]" % count if count else ""), comment))
+        width = max(len(d) for _, d, _ in decls)
+        for (fcomments, decl, comment), offset in zip(decls, sizes[name][1]):
+            out += ["    " + c for c in fcomments]
+            out.append("%s // %3d%s" % (decl.ljust(width), offset, comment and " " + comment[2:].strip() or ""))
+        out.append("} %s;" % name)
+        out.append("")
+
+    out.append("// Layout checks. A check that fails declares an array of negative size")
+    out.append("// Targets without <stddef.h> in standard_lib.h take offsets the way cc65's offsetof() does")
+    out.append("#ifdef offsetof")
+    out.append("#define WIRE_OFFSET(type, field) offsetof(type, field)")
+    out.append("#else")
+    out.append("#define WIRE_OFFSET(type, field) ((unsigned int)&((type *)0)->field)")
+    out.append("#endif")
+    for cname, value in constants.items():
+        out.append("#if %s != %d" % (cname, value))
+        out.append("#error %s does not match wire.schema" % cname)
+        out.append("#endif")
+    for name, _, fields in structs:
+        out.append("typedef char wireSize%s[sizeof(%s) == %d ? 1 : -1];" % (name, name, sizes[name][0]))
+        for (_, fname, _, _, _), offset in zip(fields, sizes[name][1]):
+            out.append("typedef char wireOffset%s_%s[WIRE_OFFSET(%s, %s) == %d ? 1 : -1];"
+                       % (name, fname, name, fname, offset))
+
+    out.append("")
+    out.append("#endif /* WIRE_H */")
+    return "\n".join(out) + "\n"
+
+
+def main(args):
+    check = "--check" in args
+    args = [a for a in args if a != "--check"]
+    schema = args[0] if args else os.path.join(ROOT, "src", "wire.schema")
+    header = args[1] if len(args) > 1 else os.path.join(ROOT, "src", "wire.h")
+
+    with open(schema) as f:
+        try:
+            text = generate(*parse(f.read()))
+        except SchemaError as e:
+            sys.exit("wiregen: %s" % e)
+
+    if check:
+        with open(header) as f:
+            if f.read() != text:
+                sys.exit("wiregen: %s is out of date with %s" % (header, schema))
+        return
+
+    with open(header, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,629 @@
+#!/usr/bin/env python3
+"""
+Reference Fuji Battleship server for offline testing and benchmarking.
+
+Implements the Api the client uses (tables, state, ready, place/, attack/, leave)
+with the binary Tables/Lobby/Game layouts from src/wire.h, including the client
+version 3 additions described in src/stateclient.h:
+  * state version trailer, "ver" and RESPONSE_NOCHANGE / RESPONSE_DELTA replies
+  * event log trailer and "ev"
+  * "wait" long-polls
+  * "mid" move ids, so a retried move is applied only once
+  * "bin=2" packed boards
+and the version 4 table list, paged with "offset" and "limit" (see tables_payload)
+Clients sending v=2 or lower get the plain structs with no trailer.
+
+Only the Python standard library is used. Game timing is fixed, and bots and
+random placement draw from a seeded RNG, so a run is repeatable. With
+--manual-clock the game clock only moves when /_advance?seconds=N is called.
+
+Usage: python3 battleship_server.py [--port 8080] [--seed 1] [--manual-clock] [--quiet] [--load-tables N]
+Then point the client at http://127.0.0.1:8080/ (the client's localServer).
+--load-tables adds N empty tables, load1..loadN, for the load generator in support/loadgen.
+"""
+
+import argparse
+import collections
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+# Mirrors src/misc.h
+PLAYER_MAX = 4
+STATUS_LOBBY = 0
+STATUS_PLACE_SHIPS = 1
+STATUS_GAMESTART = 10
+STATUS_MISS = 11
+STATUS_HIT = 12
+STATUS_SUNK = 13
+STATUS_GAMEOVER = 99
+
+PLAYER_STATUS_DEFAULT = 0
+PLAYER_STATUS_DEFEATED = 1
+PLAYER_STATUS_VIEWING = 2
+PLAYER_STATUS_READY = 3
+PLAYER_STATUS_PLACE_SHIPS = 10
+
+FIELD_ATTACK = 1
+FIELD_MISS = 2
+
+SHIP_SIZE = [5, 4, 3, 3, 2]
+
+# Game struct layout: playerCount, prompt[33], status, playerStatus, activePlayer,
+# moveTime, lastAttackPos, myShips[10], then Player: name[9], playerStatus,
+# gamefield[100], shipsLeft[5]
+GAME_HEADER_SIZE = 49
+GAME_MOVETIME_OFFSET = 37
+PLAYER_SIZE = 115
+GAME_SIZE = GAME_HEADER_SIZE + PLAYER_MAX * PLAYER_SIZE
+TABLES_MAX = 10
+
+# Mirrors src/stateclient.h
+RESPONSE_NOCHANGE = 0xFF
+RESPONSE_DELTA = 0xFE
+DELTA_MAX = 128
+EVENT_MAX = 8
+TRAILER_PACKED = 0x80
+
+# Fixed game timing, in seconds
+COUNTDOWN_SECONDS = 5
+PLACE_SECONDS = 60
+MOVE_SECONDS = 20
+BOT_MOVE_SECONDS = 2
+GAMEOVER_SECONDS = 15
+LOBBY_IDLE_SECONDS = 30
+WAIT_MAX_SECONDS = 30
+
+# Table id, name, bots seated at startup
+TABLES = [
+    ("bot1", "1 bot", 1),
+    ("bot2", "2 bots", 2),
+    ("bot3", "3 bots", 3),
+    ("duel", "2 players", 0),
+    ("party", "4 players", 0),
+]
+
+
+class Clock:
+    """Seconds since start. Real time, unless manual, where it only moves via advance()."""
+
+    def __init__(self, manual):
+        self.manual = manual
+        self.start = time.monotonic()
+        self.offset = 0.0
+
+    def now(self):
+        return self.offset if self.manual else time.monotonic() - self.start
+
+    def advance(self, seconds):
+        self.offset += seconds
+
+
+def cstr(text, size):
+    """Fixed size, zero terminated string field"""
+    data = text.encode("ascii", "replace")[:size - 1]
+    return data + bytes(size - len(data))
+
+
+def ship_cells(pos, size):
+    """Cells covered by a ship, or None if it does not fit. 100+ means vertical."""
+    vertical = pos >= 100
+    pos %= 100
+    x, y = pos % 10, pos // 10
+    if (y if vertical else x) + size > 10:
+        return None
+    step = 10 if vertical else 1
+    return [pos + i * step for i in range(size)]
+
+
+def valid_placement(ships):
+    used = set()
+    for pos, size in zip(ships, SHIP_SIZE):
+        cells = ship_cells(pos, size) if 0 <= pos < 200 else None
+        if cells is None or used.intersection(cells):
+            return False
+        used.update(cells)
+    return len(ships) == 5
+
+
+def random_placement(rng):
+    while True:
+        ships = [rng.randrange(200) for _ in SHIP_SIZE]
+        if valid_placement(ships):
+            return ships
+
+
+class Seat:
+    def __init__(self, name, bot=False):
+        self.name = name
+        self.bot = bot
+        self.ready = bot
+        self.last_seen = 0.0
+        self.reset()
+
+    def reset(self):
+        self.status = PLAYER_STATUS_DEFAULT
+        self.ships = None
+        self.field = bytearray(100)
+        self.ships_left = [1] * 5
+        self.left = False
+
+    def ship_at(self, cell):
+        for i, (pos, size) in enumerate(zip(self.ships, SHIP_SIZE)):
+            if cell in ship_cells(pos, size):
+                return i
+        return None
+
+
+class Table:
+    def __init__(self, table_id, name, bots, seed):
+        self.id = table_id
+        self.name = name
+        self.rng = random.Random(seed)
+        self.seats = [Seat("bot%d" % (i + 1), bot=True) for i in range(bots)]
+        self.version = 1
+        self.event_seq = 0
+        self.events = collections.deque(maxlen=32)  # (seq, pos, attacker seat, status)
+        self.signature = None
+        self.to_lobby(0.0)
+
+    # -- Game flow --
+
+    def to_lobby(self, now):
+        self.status = STATUS_LOBBY
+        self.active = -1
+        self.last_attack = 0
+        self.deadline = None
+        self.winner = None
+        self.seats = [s for s in self.seats if not s.left and (s.bot or now - s.last_seen < LOBBY_IDLE_SECONDS)]
+        for seat in self.seats:
+            seat.reset()
+            seat.ready = seat.bot
+
+    def alive(self):
+        return [i for i, s in enumerate(self.seats) if s.status != PLAYER_STATUS_DEFEATED]
+
+    def seat_of(self, name):
+        for i, seat in enumerate(self.seats):
+            if seat.name == name and not seat.left:
+                return i
+        return None
+
+    def join(self, name, now):
+        """Seats a player in the lobby if there is room. Returns the seat index, or None to spectate."""
+        i = self.seat_of(name)
+        if i is None and self.status == STATUS_LOBBY and len(self.seats) < PLAYER_MAX:
+            self.seats.append(Seat(name))
+            i = len(self.seats) - 1
+        if i is not None:
+            self.seats[i].last_seen = now
+        return i
+
+    def update(self, now):
+        """Advances timers and bots. Returns True if the state version changed."""
+        if self.status == STATUS_LOBBY:
+            self.seats = [s for s in self.seats if s.bot or now - s.last_seen < LOBBY_IDLE_SECONDS]
+            if len(self.seats) > 1 and all(s.ready for s in self.seats) and any(not s.bot for s in self.seats):
+                if self.deadline is None:
+                    self.deadline = now + COUNTDOWN_SECONDS
+                elif now >= self.deadline:
+                    self.status = STATUS_PLACE_SHIPS
+                    self.deadline = now + PLACE_SECONDS
+                    for seat in self.seats:
+                        seat.status = PLAYER_STATUS_PLACE_SHIPS
+                        if seat.bot:
+                            self.place(seat, random_placement(self.rng))
+            else:
+                self.deadline = None
+
+        if self.status == STATUS_PLACE_SHIPS:
+            if now >= self.deadline:
+                for seat in self.seats:
+                    if seat.ships is None:
+                        self.place(seat, random_placement(self.rng))
+            if all(s.ships is not None for s in self.seats):
+                self.status = STATUS_GAMESTART
+                self.active = self.rng.randrange(len(self.seats))
+                self.deadline = now + MOVE_SECONDS
+
+        elif STATUS_GAMESTART <= self.status < STATUS_GAMEOVER:
+            seat = self.seats[self.active]
+            if now >= self.deadline or (seat.bot and now >= self.deadline - MOVE_SECONDS + BOT_MOVE_SECONDS):
+                self.attack(self.active, self.rng.choice(self.open_cells(self.active)), now)
+
+        elif self.status == STATUS_GAMEOVER and now >= self.deadline:
+            self.to_lobby(now)
+
+        return self.bump(now)
+
+    def bump(self, now):
+        """Moves to a new state version if anything but the move timer changed. The lobby
+        countdown is part of the prompt, so each second of it is a new version."""
+        signature = (self.status, self.active, self.last_attack, self.winner, self.event_seq,
+                     self.prompt_lobby(now) if self.status == STATUS_LOBBY else None,
+                     tuple((s.name, s.ready, s.status, bytes(s.field), tuple(s.ships_left), tuple(s.ships or ()))
+                           for s in self.seats))
+        if signature == self.signature:
+            return False
+        self.signature = signature
+        self.version = self.version % 255 + 1
+        return True
+
+    def place(self, seat, ships):
+        seat.ships = list(ships)
+        seat.status = PLAYER_STATUS_DEFAULT
+
+    def open_cells(self, attacker):
+        """Cells still unattacked on at least one opponent"""
+        return [pos for pos in range(100)
+                if any(self.seats[i].field[pos] == 0 for i in self.alive() if i != attacker)]
+
+    def attack(self, attacker, pos, now):
+        if pos not in self.open_cells(attacker):
+            return False
+
+        result = STATUS_MISS
+        for i in self.alive():
+            seat = self.seats[i]
+            if i == attacker or seat.field[pos]:
+                continue
+            ship = seat.ship_at(pos)
+            if ship is None:
+                seat.field[pos] = FIELD_MISS
+                continue
+            seat.field[pos] = FIELD_ATTACK
+            result = max(result, STATUS_HIT)
+            pos_, size = seat.ships[ship], SHIP_SIZE[ship]
+            if all(seat.field[c] == FIELD_ATTACK for c in ship_cells(pos_, size)):
+                seat.ships_left[ship] = 0
+                result = STATUS_SUNK
+                if not any(seat.ships_left):
+                    seat.status = PLAYER_STATUS_DEFEATED
+
+        self.last_attack = pos
+        self.event_seq = self.event_seq % 255 + 1
+        self.events.append((self.event_seq, pos, attacker, result))
+
+        alive = self.alive()
+        if len(alive) < 2 or all(self.seats[i].left for i in alive):
+            self.status = STATUS_GAMEOVER
+            self.winner = alive[0] if alive else attacker
+            self.active = self.winner
+            self.deadline = now + GAMEOVER_SECONDS
+        else:
+            self.status = result
+            self.next_turn(now)
+        return True
+
+    def next_turn(self, now):
+        alive = self.alive()
+        i = self.active
+        while True:
+            i = (i + 1) % len(self.seats)
+            if i in alive:
+                break
+        self.active = i
+        self.deadline = now + MOVE_SECONDS
+
+    def leave(self, name, now):
+        i = self.seat_of(name)
+        if i is None:
+            return
+        if self.status == STATUS_LOBBY:
+            del self.seats[i]
+            self.deadline = None
+        else:
+            seat = self.seats[i]
+            seat.left = True
+            seat.status = PLAYER_STATUS_DEFEATED
+            alive = self.alive()
+            if self.status != STATUS_GAMEOVER and len(alive) < 2:
+                self.status = STATUS_GAMEOVER
+                self.winner = alive[0] if alive else i
+                self.active = self.winner
+                self.deadline = now + GAMEOVER_SECONDS
+            elif self.active == i and STATUS_GAMESTART <= self.status < STATUS_GAMEOVER:
+                self.next_turn(now)
+
+    # -- Payloads --
+
+    def players_text(self):
+        return "%d/%d" % (len([s for s in self.seats if not s.bot]), PLAYER_MAX)
+
+    def prompt_lobby(self, now):
+        if self.deadline is not None:
+            return "starting in %d" % max(1, int(self.deadline - now + 0.999))
+        if len(self.seats) < 2:
+            return "waiting for players"
+        return "waiting for everyone to ready up"
+
+    def order(self, me):
+        """Seat indexes in the requesting player's order, with them first"""
+        n = len(self.seats)
+        return [(me + i) % n for i in range(n)]
+
+    def lobby_payload(self, me, now):
+        seats = self.order(me if me is not None else 0)
+        data = bytes([len(seats)]) + cstr(self.prompt_lobby(now), 33)
+        status = PLAYER_STATUS_VIEWING if me is None else (PLAYER_STATUS_READY if self.seats[me].ready else PLAYER_STATUS_DEFAULT)
+        data += bytes([STATUS_LOBBY, status, 0xFF, 0]) + cstr(self.name, 21)
+        for i in seats:
+            data += cstr(self.seats[i].name, 9) + bytes([1 if self.seats[i].ready else 0])
+        return data
+
+    def game_payload(self, me, now):
+        """Full size Game struct as this player sees it, and how many players it holds"""
+        view = me if me is not None else 0
+        seats = self.order(view)
+        rel = {seat: i for i, seat in enumerate(seats)}
+
+        if self.status == STATUS_PLACE_SHIPS:
+            prompt = "place your ships"
+        elif self.status == STATUS_GAMEOVER:
+            prompt = "you win!" if self.winner == me else "%s wins" % self.seats[self.winner].name
+        elif self.active == me:
+            prompt = "your turn"
+        else:
+            prompt = "%s's turn" % self.seats[self.active].name
+
+        move_time = 0
+        if self.deadline is not None and self.status != STATUS_GAMEOVER:
+            move_time = max(0, min(255, int(self.deadline - now)))
+
+        my_ships = list(self.seats[me].ships or [0] * 5) if me is not None else [0] * 5
+        my_ships += self.seats[self.winner].ships if self.status == STATUS_GAMEOVER else [0] * 5
+        active = rel[self.active] if self.active >= 0 else -1
+        status = PLAYER_STATUS_VIEWING if me is None else self.seats[me].status
+
+        data = bytearray([len(seats)]) + cstr(prompt, 33)
+        data += bytes([self.status, status, active & 0xFF, move_time, self.last_attack]) + bytes(my_ships)
+        for i in seats:
+            seat = self.seats[i]
+            data += cstr(seat.name, 9) + bytes([seat.status]) + seat.field + bytes(seat.ships_left)
+        return bytes(data + bytes(GAME_SIZE - len(data))), len(seats)
+
+    def events_since(self, seq, me):
+        """Event records after seq, relative to this player's order"""
+        if not seq:
+            return []
+        found = []
+        for event in reversed(self.events):
+            if event[0] == seq:
+                break
+            found.append(event)
+        n = len(self.seats)
+        view = me if me is not None else 0
+        return [(pos, (attacker - view) % n, result) for _, pos, attacker, result in reversed(found[:EVENT_MAX])]
+
+
+def tables_payload(tables, version, offset=0, limit=TABLES_MAX):
+    """The table list. From v4, a page of limit tables from offset, after the total and the offset"""
+    if version < 4:
+        offset, limit = 0, TABLES_MAX
+    offset = max(0, min(offset, len(tables), 255))
+    page = tables[offset:offset + max(1, min(limit, TABLES_MAX))]
+    data = bytes([len(page)])
+    if version >= 4:
+        data += bytes([min(len(tables), 255), offset])
+    for table in page:
+        data += cstr(table.id, 9) + cstr(table.name, 21) + cstr(table.players_text(), 6)
+    return data
+
+
+def pack_game(data, count):
+    """Game payload with 2-bit boards, four cells per byte, first cell in the low bits"""
+    out = bytearray(data[:GAME_HEADER_SIZE])
+    for i in range(count):
+        player = data[GAME_HEADER_SIZE + i * PLAYER_SIZE:GAME_HEADER_SIZE + (i + 1) * PLAYER_SIZE]
+        field = player[10:110]
+        out += player[:10]
+        out += bytes(field[j] | field[j + 1] << 2 | field[j + 2] << 4 | field[j + 3] << 6 for j in range(0, 100, 4))
+        out += player[110:]
+    return bytes(out)
+
+
+def delta_records(old, new):
+    """[offset lo][offset hi][length][bytes..] records turning old into new, always including moveTime"""
+    changed = [i for i in range(GAME_SIZE) if old[i] != new[i] or i == GAME_MOVETIME_OFFSET]
+    records = bytearray()
+    while changed:
+        # Extend the run over gaps too short to be worth the 3 byte header of a new record
+        start = end = changed.pop(0)
+        while changed and changed[0] - end <= 3 and changed[0] - start < 255:
+            end = changed.pop(0)
+        records += bytes([start & 0xFF, start >> 8, end + 1 - start]) + new[start:end + 1]
+    return bytes(records)
+
+
+class Server:
+    def __init__(self, seed, manual_clock, load_tables=0):
+        self.clock = Clock(manual_clock)
+        self.cond = threading.Condition()
+        tables = TABLES + [("load%d" % n, "load %d" % n, 0) for n in range(1, load_tables + 1)]
+        self.tables = [Table(tid, name, bots, seed + i) for i, (tid, name, bots) in enumerate(tables)]
+        self.by_id = {table.id: table for table in self.tables}
+        self.clients = {}  # (table, player) -> {"mid": last applied move id, "history": {version: game bytes}}
+
+    def find(self, table_id):
+        return self.by_id.get(table_id)
+
+    def tick(self):
+        """Advances all tables, waking long-polls on a change. Called with the lock held."""
+        now = self.clock.now()
+        if any([table.update(now) for table in self.tables]):
+            self.cond.notify_all()
+
+    def handle(self, path, args):
+        """Returns (status code, body)"""
+        version = int(args.get("v", "2") or 0)
+        parts = path.strip("/").split("/")
+        command = parts[0]
+
+        with self.cond:
+            self.tick()
+            now = self.clock.now()
+
+            if command == "_advance":
+                self.clock.advance(float(args.get("seconds", "1")))
+                self.tick()
+                return 200, b""
+
+            if command == "tables":
+                data = tables_payload(self.tables, version, int(args.get("offset", "0") or 0),
+                                      int(args.get("limit", str(TABLES_MAX)) or 0))
+                return 200, data + bytes([0, 0, 0]) if version >= 3 else data
+
+            table = self.find(args.get("table", ""))
+            name = args.get("player", "")[:8]
+            if table is None or not name:
+                return 404, b""
+
+            client = self.clients.setdefault((table.id, name), {"mid": 0, "history": {}})
+
+            if command == "leave":
+                table.leave(name, now)
+                table.bump(now)
+                self.cond.notify_all()
+                return 200, b""
+
+            me = table.join(name, now)
+
+            # A repeat of the last applied move is answered as a poll
+            mid = int(args.get("mid", "0") or 0)
+            if me is not None and (not mid or mid != client["mid"]):
+                client["mid"] = mid
+                seat = table.seats[me]
+                if command == "ready" and table.status == STATUS_LOBBY:
+                    seat.ready = not seat.ready
+                elif command == "place" and len(parts) > 1 and table.status == STATUS_PLACE_SHIPS and seat.ships is None:
+                    try:
+                        ships = [int(p) for p in parts[1].split(",")]
+                    except ValueError:
+                        ships = []
+                    if valid_placement(ships):
+                        table.place(seat, ships)
+                elif command == "attack" and len(parts) > 1 and parts[1].isdigit() and table.active == me \
+                        and STATUS_GAMESTART <= table.status < STATUS_GAMEOVER:
+                    table.attack(me, int(parts[1]), now)
+            self.tick()
+
+            # Long-poll: hold until the state changes or the wait runs out
+            ver = int(args.get("ver", "0") or 0)
+            wait = min(float(args.get("wait", "0") or 0), WAIT_MAX_SECONDS)
+            if version >= 3 and ver == table.version and wait > 0:
+                until = time.monotonic() + wait
+                while ver == table.version and time.monotonic() < until:
+                    self.cond.wait(until - time.monotonic())
+                now = self.clock.now()
+                me = table.seat_of(name)
+
+            return 200, self.state_reply(table, me, client, args, version, now)
+
+    def state_reply(self, table, me, client, args, version, now):
+        history = client["history"]
+        if table.status == STATUS_LOBBY:
+            data, count, game = table.lobby_payload(me, now), 0, False
+        else:
+            data, count = table.game_payload(me, now)
+            game = table.status >= STATUS_PLACE_SHIPS
+
+        if version < 3:
+            return data[:GAME_HEADER_SIZE + count * PLAYER_SIZE] if game else data
+
+        ver = int(args.get("ver", "0") or 0)
+        if ver == table.version:
+            return bytes([RESPONSE_NOCHANGE, table.version])
+
+        events = table.events_since(int(args.get("ev", "0") or 0), me)
+        event_bytes = b"".join(bytes(e) for e in events)
+        packed = args.get("bin") == "2" and game
+
+        def trailer(flags=0):
+            return event_bytes + bytes([len(events) | flags, table.event_seq, table.version])
+
+        if not game:
+            history.clear()
+            return data + trailer()
+
+        # Keep a few recent payloads per client to build deltas from
+        old = history.get(ver)
+        history[table.version] = data
+        while len(history) > 8:
+            del history[next(iter(history))]
+
+        if old is not None and old[0] == data[0]:
+            records = delta_records(old, data)
+            if len(records) + len(event_bytes) + 3 <= DELTA_MAX:
+                return bytes([RESPONSE_DELTA]) + records + trailer()
+
+        body = data[:GAME_HEADER_SIZE + count * PLAYER_SIZE]
+        if packed:
+            return pack_game(body, count) + trailer(TRAILER_PACKED)
+        return body + trailer()
+
+
+def make_handler(server, quiet):
+    class Handler(BaseHTTPRequestHandler):
+        # Keep-alive, as used by the client's TCP session
+        protocol_version = "HTTP/1.1"
+        # Headers and body go out as separate writes, so do not let the body wait on an ACK
+        disable_nagle_algorithm = True
+
+        def do_GET(self):
+            url = urlsplit(self.path)
+            args = {k: v[0] for k, v in parse_qs(url.query).items()}
+            code, body = server.handle(url.path, args)
+            try:
+                self.send_response(code)
+                self.send_header("Content-Type", "application/octet-stream")
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+            except (BrokenPipeError, ConnectionResetError):
+                # The client drops a held long-poll to send a move
+                self.close_connection = True
+
+        def log_message(self, format, *args):
+            if not quiet:
+                super().log_message(format, *args)
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Reference Fuji Battleship server")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--seed", type=int, default=1, help="RNG seed for bots and random placement")
+    parser.add_argument("--manual-clock", action="store_true", help="Only advance game time via /_advance?seconds=N")
+    parser.add_argument("--quiet", action="store_true", help="Do not log requests")
+    parser.add_argument("--load-tables", type=int, default=0, metavar="N", help="Add N empty tables, load1..loadN")
+    options = parser.parse_args()
+
+    server = Server(options.seed, options.manual_clock, options.load_tables)
+    # Room for many clients connecting at once, as under the load generator
+    ThreadingHTTPServer.request_queue_size = 128
+    httpd = ThreadingHTTPServer((options.host, options.port), make_handler(server, options.quiet))
+    httpd.daemon_threads = True
+
+    # Real time mode: move timers, bots and long-polls along without waiting on a request
+    def ticker():
+        while True:
+            time.sleep(0.1)
+            with server.cond:
+                server.tick()
+
+    if not options.manual_clock:
+        threading.Thread(target=ticker, daemon=True).start()
+
+    print("Fuji Battleship reference server on http://%s:%d/" % (options.host, options.port))
+    try:
+        httpd.serve_forever()
+    except KeyboardInterrupt:
+        print("Exiting")
+
+
+if __name__ == "__main__":
+    main()